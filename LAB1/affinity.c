@@ -0,0 +1,179 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include "affinity.h"
+
+// "auto" 或 CPU 編號，格式錯誤回傳 AFFINITY_NONE
+int affinity_parse(const char* arg)
+{
+    if (strcmp(arg, "auto") == 0)
+        return AFFINITY_AUTO;
+    char* end;
+    long cpu = strtol(arg, &end, 10);
+    return *end == '\0' && cpu >= 0 && cpu < CPU_SETSIZE ? (int)cpu : AFFINITY_NONE;
+}
+
+static int read_sysfs(const char* path, char* buf, size_t cap)
+{
+    FILE* fp = fopen(path, "r");
+    if (fp == NULL)
+        return -1;
+    int ok = fgets(buf, cap, fp) != NULL;
+    fclose(fp);
+    if (!ok)
+        return -1;
+    buf[strcspn(buf, "\n")] = '\0';
+    return 0;
+}
+
+// 解析 sysfs 的 CPU 清單，例如 "0-3,8-11"
+static void parse_cpu_list(const char* list, cpu_set_t* set)
+{
+    CPU_ZERO(set);
+    while (*list)
+    {
+        char* end;
+        long lo = strtol(list, &end, 10), hi = lo;
+        if (end == list)
+            break;
+        if (*end == '-')
+            hi = strtol(end + 1, &end, 10);
+        for (long cpu = lo; cpu <= hi && cpu < CPU_SETSIZE; ++cpu)
+            CPU_SET(cpu, set);
+        list = *end == ',' ? end + 1 : end;
+    }
+}
+
+// 和 cpu 共用同一個 SMT core 的 CPU (包含自己)
+static void smt_siblings(int cpu, cpu_set_t* set)
+{
+    char path[128], buf[256];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", cpu);
+    CPU_ZERO(set);
+    if (read_sysfs(path, buf, sizeof(buf)) == 0)
+        parse_cpu_list(buf, set);
+    CPU_SET(cpu, set);
+}
+
+// 和 cpu 共用第 level 層 data / unified cache 的 CPU，沒有這一層回傳 -1
+static int cache_shared(int cpu, int level, cpu_set_t* set, char* list, size_t cap)
+{
+    char path[128], buf[256];
+    for (int index = 0; ; ++index)
+    {
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cache/index%d/level", cpu, index);
+        if (read_sysfs(path, buf, sizeof(buf)) == -1)
+            return -1;
+        if (atoi(buf) != level)
+            continue;
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cache/index%d/type", cpu, index);
+        if (read_sysfs(path, buf, sizeof(buf)) == -1 || strcmp(buf, "Instruction") == 0)
+            continue;
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cache/index%d/shared_cpu_list", cpu, index);
+        if (read_sysfs(path, buf, sizeof(buf)) == -1)
+            return -1;
+        parse_cpu_list(buf, set);
+        if (list != NULL)
+            snprintf(list, cap, "%s", buf);
+        return 0;
+    }
+}
+
+/**
+ * 在允許的 CPU 中挑一對不同 core 的 CPU，優先共用 L2，其次共用 L3，
+ * 都沒有就任選兩個不同的 core，再不行才用同一個 core 的兩個 hyperthread
+ * 結果只取決於 sysfs 與 affinity mask，sender 與 receiver 各自算出來的會是同一對
+ */
+static void pick_pair(int pair[2])
+{
+    cpu_set_t allowed, siblings, shared;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == -1)
+    {
+        CPU_ZERO(&allowed);
+        CPU_SET(0, &allowed);
+    }
+
+    for (int level = 2; level <= 4; ++level)
+    {
+        for (int a = 0; a < CPU_SETSIZE; ++a)
+        {
+            if (!CPU_ISSET(a, &allowed))
+                continue;
+            smt_siblings(a, &siblings);
+            int have_cache = level <= 3 ? cache_shared(a, level, &shared, NULL, 0) == 0 : 0;
+            for (int b = a + 1; b < CPU_SETSIZE; ++b)
+            {
+                if (!CPU_ISSET(b, &allowed) || CPU_ISSET(b, &siblings))
+                    continue;
+                // level 4 代表不要求共用 cache
+                if (level <= 3 && (!have_cache || !CPU_ISSET(b, &shared)))
+                    continue;
+                pair[0] = a;
+                pair[1] = b;
+                return;
+            }
+        }
+    }
+
+    // 只剩同一個 core：兩個 hyperthread，或只有一顆 CPU 時兩邊放在一起
+    pair[0] = pair[1] = -1;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+    {
+        if (!CPU_ISSET(cpu, &allowed))
+            continue;
+        if (pair[0] == -1)
+            pair[0] = pair[1] = cpu;
+        else
+        {
+            pair[1] = cpu;
+            break;
+        }
+    }
+}
+
+/**
+ * 把目前的行程綁到 cpu (AFFINITY_AUTO 時依 role 從挑好的一對中取一個)
+ * 回傳實際綁定的 CPU，沒有綁定回傳 AFFINITY_NONE
+ */
+int affinity_apply(int cpu, int role)
+{
+    if (cpu == AFFINITY_NONE)
+        return AFFINITY_NONE;
+    if (cpu == AFFINITY_AUTO)
+    {
+        int pair[2];
+        pick_pair(pair);
+        cpu = pair[role == ROLE_RECEIVER];
+    }
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) == -1)
+    {
+        perror("sched_setaffinity failed");
+        return AFFINITY_NONE;
+    }
+    return cpu;
+}
+
+// 結束時的摘要：綁定的 CPU (沒綁定就是最後執行的 CPU) 以及它和哪些 CPU 共用 L2 / L3
+void affinity_describe(int cpu, char* buf, size_t cap)
+{
+    char l2[256] = "?", l3[256] = "?", smt[256] = "?";
+    int pinned = cpu != AFFINITY_NONE;
+    if (!pinned)
+        cpu = sched_getcpu();
+
+    cpu_set_t set;
+    cache_shared(cpu, 2, &set, l2, sizeof(l2));
+    cache_shared(cpu, 3, &set, l3, sizeof(l3));
+    char path[128];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", cpu);
+    read_sysfs(path, smt, sizeof(smt));
+
+    snprintf(buf, cap, "%s cpu %d (SMT siblings %s, L2 shared with %s, L3 shared with %s)",
+             pinned ? "pinned to" : "not pinned, last ran on", cpu, smt, l2, l3);
+}
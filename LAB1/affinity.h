@@ -0,0 +1,15 @@
+#ifndef AFFINITY_H
+#define AFFINITY_H
+#include <stddef.h>
+
+#define AFFINITY_NONE -1        // 不綁定，交給 scheduler
+#define AFFINITY_AUTO -2        // 依 cache 拓樸自動挑選
+
+#define ROLE_SENDER 0
+#define ROLE_RECEIVER 1
+
+int affinity_parse(const char* arg);
+int affinity_apply(int cpu, int role);
+void affinity_describe(int cpu, char* buf, size_t cap);
+
+#endif
@@ -0,0 +1,165 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/ipc.h>
+#include <sys/msg.h>
+#include "batch.h"
+
+#define FRAME_HEADER (offsetof(frame_t, payload) - sizeof(long))
+
+static long elapsed_ns(const struct timespec* since)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - since->tv_sec) * 1000000000L + (now.tv_nsec - since->tv_nsec);
+}
+
+// 讀取 kernel.msgmax，讀不到時視為預設值
+static size_t read_msgmax(void)
+{
+    long msgmax = BATCH_MSGMAX;
+    FILE* f = fopen("/proc/sys/kernel/msgmax", "r");
+    if (f != NULL)
+    {
+        if (fscanf(f, "%ld", &msgmax) != 1)
+            msgmax = BATCH_MSGMAX;
+        fclose(f);
+    }
+    return msgmax > 0 ? (size_t)msgmax : BATCH_MSGMAX;
+}
+
+/**
+ * deadline_us 為 0 時每筆紀錄放入後立即送出 (等同不打包)
+ * frame 的 count 加上 payload 不能超過 kernel.msgmax，否則 msgsnd 會回傳 EINVAL
+ */
+batch_t* batch_create(long deadline_us)
+{
+    batch_t* batch = calloc(1, sizeof(batch_t));
+    if (batch == NULL)
+    {
+        perror("calloc batch failed");
+        exit(1);
+    }
+    batch->frame.mtype = 1;
+    batch->deadline_ns = deadline_us * 1000;
+
+    size_t msgmax = read_msgmax();
+    batch->cap = BATCH_SIZE;
+    if (msgmax < FRAME_HEADER + BATCH_SIZE)
+        batch->cap = msgmax > FRAME_HEADER ? msgmax - FRAME_HEADER : 0;
+    if (batch->cap < sizeof(msg_hdr_t) + MAX)
+    {
+        fprintf(stderr, "kernel.msgmax (%zu) is too small for one message\n", msgmax);
+        exit(1);
+    }
+    return batch;
+}
+
+void batch_free(batch_t* batch)
+{
+    free(batch);
+}
+
+// 把一筆紀錄放進 frame，剩餘空間不夠時回傳 -1 (呼叫端應先送出)
+int batch_append(batch_t* batch, const msg_hdr_t* hdr, const char* data)
+{
+    if (batch->used + sizeof(*hdr) + hdr->len > batch->cap)
+        return -1;
+
+    if (batch->frame.count == 0)
+        clock_gettime(CLOCK_MONOTONIC, &batch->first);
+    memcpy(batch->frame.payload + batch->used, hdr, sizeof(*hdr));
+    memcpy(batch->frame.payload + batch->used + sizeof(*hdr), data, hdr->len);
+    batch->used += sizeof(*hdr) + hdr->len;
+    batch->frame.count++;
+    return 0;
+}
+
+// frame 中的第一筆紀錄是否已經等超過 deadline
+int batch_due(batch_t* batch)
+{
+    return batch->frame.count > 0 && elapsed_ns(&batch->first) >= batch->deadline_ns;
+}
+
+/**
+ * frame 中還有紀錄在等待時，最多等到 deadline 看 fds 中有沒有任何一個有新的輸入
+ * nfds 為 0 代表已經有輸入在等著送，不需要等
+ * 回傳 1 代表 deadline 已到而輸入還沒準備好，呼叫端應該先送出
+ */
+int batch_wait_input(batch_t* batch, struct pollfd* fds, int nfds)
+{
+    if (batch->frame.count == 0 || nfds == 0)
+        return 0;
+
+    long remaining = batch->deadline_ns - elapsed_ns(&batch->first);
+    if (remaining <= 0)
+        return 1;
+
+    int ret = poll(fds, nfds, (int)((remaining + 999999) / 1000000));
+    return ret == 0;
+}
+
+// sender：frame 中是否還沒有任何紀錄
+int batch_empty_frame(batch_t* batch)
+{
+    return batch->frame.count == 0;
+}
+
+// 只送出 frame 的有效長度，回傳送出的 frame 數 (0 或 1)
+int batch_flush(batch_t* batch, int msqid)
+{
+    if (batch->frame.count == 0)
+        return 0;
+
+    while (msgsnd(msqid, &batch->frame, FRAME_HEADER + batch->used, 0) == -1)
+    {
+        if (errno != EINTR)
+        {
+            perror("msgsnd failed");
+            exit(1);
+        }
+    }
+    batch->used = 0;
+    batch->frame.count = 0;
+    return 1;
+}
+
+// receiver：目前的 frame 是否已經取完
+int batch_empty(batch_t* batch)
+{
+    return batch->next >= batch->frame.count;
+}
+
+// receiver：從 message queue 收下一個 frame
+int batch_recv(batch_t* batch, int msqid)
+{
+    while (msgrcv(msqid, &batch->frame, FRAME_HEADER + BATCH_SIZE, 1, 0) == -1)
+    {
+        if (errno != EINTR)
+        {
+            perror("msgrcv failed");
+            exit(1);
+        }
+    }
+    batch->off = 0;
+    batch->next = 0;
+    return batch->frame.count;
+}
+
+// receiver：從 frame 取出下一筆紀錄，回傳長度；frame 已取完回傳 -1
+int batch_next(batch_t* batch, msg_hdr_t* hdr, char* data, size_t cap)
+{
+    if (batch_empty(batch))
+        return -1;
+
+    // payload 中的紀錄沒有對齊，標頭要用 memcpy 取出
+    memcpy(hdr, batch->frame.payload + batch->off, sizeof(*hdr));
+    uint32_t len = hdr->len;
+    memcpy(data, batch->frame.payload + batch->off + sizeof(*hdr), len < cap ? len : cap);
+    batch->off += sizeof(*hdr) + len;
+    batch->next++;
+    hdr->len = len < cap ? len : cap;
+    return hdr->len;
+}
\ No newline at end of file
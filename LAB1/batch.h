@@ -0,0 +1,46 @@
+#ifndef BATCH_H
+#define BATCH_H
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include <poll.h>
+#include "msghdr.h"
+
+#define BATCH_MSGMAX 8192                               // kernel.msgmax 的預設值：一則 SysV 訊息 (不含 mtype) 的上限
+#define BATCH_SIZE (BATCH_MSGMAX - sizeof(uint32_t))    // 一個 frame 最多可以打包的 bytes 數，加上 count 剛好是 msgmax
+
+// message queue 上實際傳送的 frame
+// payload 是連續的 [msg_hdr_t][內容] 紀錄，共 count 筆
+typedef struct
+{
+    long mtype;
+    uint32_t count;
+    char payload[BATCH_SIZE];
+} frame_t;
+
+// 打包 / 拆包的狀態，sender 與 receiver 各自持有一份
+typedef struct
+{
+    frame_t frame;
+    size_t used;                // sender：payload 已使用的 bytes
+    size_t cap;                 // sender：payload 實際可用的 bytes (msgmax 比預設小時會縮小)
+    long deadline_ns;           // sender：第一筆紀錄放入後最多等多久就必須送出
+    struct timespec first;      // sender：第一筆紀錄放入的時間
+    size_t off;                 // receiver：下一筆紀錄在 payload 中的位置
+    uint32_t next;              // receiver：已經取出的紀錄數
+} batch_t;
+
+batch_t* batch_create(long deadline_us);
+void batch_free(batch_t* batch);
+
+int batch_append(batch_t* batch, const msg_hdr_t* hdr, const char* data);
+int batch_due(batch_t* batch);
+int batch_wait_input(batch_t* batch, struct pollfd* fds, int nfds);
+int batch_flush(batch_t* batch, int msqid);
+int batch_empty_frame(batch_t* batch);
+
+int batch_empty(batch_t* batch);
+int batch_recv(batch_t* batch, int msqid);
+int batch_next(batch_t* batch, msg_hdr_t* hdr, char* data, size_t cap);
+
+#endif
\ No newline at end of file
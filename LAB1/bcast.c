@@ -0,0 +1,127 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include "bcast.h"
+#include "shmseg.h"
+
+void bcast_attach(bcast_port_t* port, key_t key, int huge, int writer)
+{
+    port->page = shm_attach(key, sizeof(bcast_t), huge, NULL);
+    // 上一次的 sender 留下的 segment 還標記著 closed，新的 sender 要把它重新打開
+    if (writer)
+        atomic_store(&port->page->closed, 0);
+    // 從目前的版本開始，之前留下的內容不算新訊息
+    port->seen = atomic_load(&port->page->seq) & ~1u;
+    port->reads = 0;
+    port->missed = 0;
+    port->retries = 0;
+}
+
+void bcast_detach(bcast_port_t* port)
+{
+    shmdt(port->page);
+}
+
+/**
+ * sender：最後一則 (EOF) 發布之後呼叫，segment 留著不刪
+ * 之後才啟動的 receiver 附加上來會直接讀到最後的版本，而不是永遠等下去
+ */
+void bcast_close(bcast_port_t* port)
+{
+    bcast_t* b = port->page;
+    atomic_store_explicit(&b->closed, 1, memory_order_release);
+    if (atomic_load(&b->waiters) > 0)
+        futex_wake(&b->seq, INT_MAX);
+}
+
+// receiver：sender 已經 close 而且沒有其他行程還附加著時，由最後離開的 receiver 刪除 segment
+void bcast_leave(bcast_port_t* port, key_t key)
+{
+    int closed = atomic_load(&port->page->closed);
+    shmdt(port->page);
+    if (!closed)
+        return;
+
+    // 兩個 receiver 同時離開可能都看到 0，第二次 IPC_RMID 失敗也無妨
+    struct shmid_ds ds;
+    int shmid = shmget(key, 0, 0666);
+    if (shmid != -1 && shmctl(shmid, IPC_STAT, &ds) == 0 && ds.shm_nattch == 0)
+        shmctl(shmid, IPC_RMID, NULL);
+}
+
+/**
+ * sender：覆寫最新的訊息，永遠不會被 receiver 擋住
+ * seq 先加 1 變成奇數，寫完再加 1 變回偶數
+ */
+void bcast_publish(bcast_port_t* port, const msg_hdr_t* hdr, const char* data)
+{
+    bcast_t* b = port->page;
+    size_t len = hdr->len < RING_SLOT_SIZE ? hdr->len : RING_SLOT_SIZE;
+    uint32_t seq = atomic_load_explicit(&b->seq, memory_order_relaxed);
+
+    atomic_store_explicit(&b->seq, seq + 1, memory_order_relaxed);
+    // 內容的寫入不能跑到 seq 變成奇數之前
+    atomic_thread_fence(memory_order_release);
+    b->hdr = *hdr;
+    b->hdr.len = len;
+    memcpy(b->data, data, len);
+    atomic_store_explicit(&b->seq, seq + 2, memory_order_release);
+
+    if (atomic_load(&b->waiters) > 0)
+        futex_wake(&b->seq, INT_MAX);
+}
+
+/**
+ * receiver：等到比上次更新的版本，複製一份一致的快照，回傳長度
+ * 中間被覆寫的版本直接跳過 (只關心最新的值)，計入 missed
+ * sender 已經 close 時不再等，直接回傳最後的版本 (也就是 EOF)
+ */
+int bcast_read(bcast_port_t* port, msg_hdr_t* hdr, char* data, size_t cap)
+{
+    bcast_t* b = port->page;
+    int waited = 0;
+    for (;;)
+    {
+        uint32_t seq = atomic_load_explicit(&b->seq, memory_order_acquire);
+        int closed = atomic_load_explicit(&b->closed, memory_order_acquire);
+        if ((seq == port->seen && !closed) || (seq & 1))
+        {
+            if (!waited)
+                stats_add(STAT_EMPTY, 1);
+            waited = 1;
+            // 還沒有新版本 (或 sender 正在寫)：先 spin，再睡在 seq 上
+            int spins = 0;
+            while (spins++ < spin_limit() && atomic_load_explicit(&b->seq, memory_order_acquire) == seq)
+                cpu_relax();
+            if (atomic_load(&b->seq) == seq && !atomic_load(&b->closed))
+            {
+                atomic_fetch_add(&b->waiters, 1);
+                futex_wait(&b->seq, seq);
+                atomic_fetch_sub(&b->waiters, 1);
+            }
+            continue;
+        }
+
+        msg_hdr_t snapshot = b->hdr;
+        size_t len = snapshot.len < cap ? snapshot.len : cap;
+        memcpy(data, b->data, len);
+        // 複製的讀取不能跑到再次檢查 seq 之後
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&b->seq, memory_order_relaxed) != seq)
+        {
+            port->retries++;
+            continue;
+        }
+
+        if (seq != port->seen)
+            port->missed += (seq - port->seen) / 2 - 1;
+        port->seen = seq;
+        port->reads++;
+        *hdr = snapshot;
+        hdr->len = len;
+        return (int)len;
+    }
+}
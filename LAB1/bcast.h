@@ -0,0 +1,41 @@
+#ifndef BCAST_H
+#define BCAST_H
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <sys/types.h>
+#include "mbsync.h"
+#include "msghdr.h"
+#include "ring.h"
+
+// 一塊共享記憶體放「最新的一則訊息」，以 seqlock 保護：
+// 一個 sender 隨時覆寫，任意多個 receiver 讀取目前的快照，彼此都不必等對方
+// seq 為奇數代表寫到一半，讀到的內容要丟掉重讀
+typedef struct
+{
+    _Alignas(CACHE_LINE) _Atomic uint32_t seq;      // 也是 receiver 等新版本的 futex word
+    _Atomic uint32_t waiters;                       // 睡在 seq 上的 receiver 數
+    _Atomic uint32_t closed;                        // sender 已經寫完最後一則 (EOF) 並離開
+    _Alignas(CACHE_LINE) msg_hdr_t hdr;
+    char data[RING_SLOT_SIZE];
+} bcast_t;
+
+// 每個行程各自的狀態
+typedef struct
+{
+    bcast_t* page;
+    uint32_t seen;          // receiver：上一次讀到的版本
+    uint64_t reads;         // receiver：讀到的快照數
+    uint64_t missed;        // receiver：還沒讀就被覆寫掉的版本數
+    uint64_t retries;       // receiver：讀到寫了一半的內容而重讀的次數
+} bcast_port_t;
+
+void bcast_attach(bcast_port_t* port, key_t key, int huge, int writer);
+void bcast_detach(bcast_port_t* port);
+void bcast_close(bcast_port_t* port);
+void bcast_leave(bcast_port_t* port, key_t key);
+
+void bcast_publish(bcast_port_t* port, const msg_hdr_t* hdr, const char* data);
+int bcast_read(bcast_port_t* port, msg_hdr_t* hdr, char* data, size_t cap);
+
+#endif
@@ -0,0 +1,113 @@
+#!/bin/bash
+# IPC transport benchmark：對每一種 mechanism / 同步機制 / 訊息大小 / 送出速率
+# 自動產生輸入檔、啟動一組 sender 與 receiver，最後印出延遲與吞吐量的表格
+# 兩邊都以 -Q 執行，量到的是 transport 而不是終端機輸出的成本
+#
+# 可用環境變數 (或 make bench BENCH_COUNT=... ) 調整：
+#   BENCH_MECHS         要測的 mechanism            (預設 "1 2 3 4 5 6 7")
+#   BENCH_SYNCS         要測的同步機制              (預設 "sysv futex")
+#   BENCH_SIZES         每則訊息的大小 (bytes)      (預設 "8 64 512 1024 4096 65536")
+#   BENCH_RATES         sender 送出速率 (msg/s[:burst])，0 代表不限速 (預設 "0 10000")
+#   BENCH_BATCH         mechanism 1 打包訊息的 deadline (usec)，0 代表不打包 (預設 "0 100")
+#   BENCH_WINDOW        receiver 給 sender 的 credit 數 (預設 1)
+#   BENCH_COUNT         每次測試的訊息數            (預設 10000)
+#   BENCH_SENDER_CPU    sender 綁定的 CPU           (預設 0)
+#   BENCH_RECEIVER_CPU  receiver 綁定的 CPU         (預設：最後一顆 CPU)
+#   BENCH_AFFINITY      設為 auto 時改由兩個程式依 cache 拓樸自己挑 CPU (-a auto)，忽略上面兩個設定
+#   BENCH_TIMEOUT       單次測試的時間上限 (秒)     (預設 60)
+#   BENCH_CSV           若有設定，把原始結果另外寫成 CSV 檔
+#   BENCH_ZEROCOPY      若有設定，sender 以 -z (zero-copy) 送出，不測 mechanism 4
+
+cd "$(dirname "$0")" || exit 1
+
+MECHS=${BENCH_MECHS:-"1 2 3 4 5 6 7"}
+SYNCS=${BENCH_SYNCS:-"sysv futex"}
+SIZES=${BENCH_SIZES:-"8 64 512 1024 4096 65536"}
+RATES=${BENCH_RATES:-"0 10000"}
+BATCHES=${BENCH_BATCH:-"0 100"}
+COUNT=${BENCH_COUNT:-10000}
+WINDOW=${BENCH_WINDOW:-1}
+NCPU=$(nproc 2>/dev/null || echo 1)
+SENDER_CPU=${BENCH_SENDER_CPU:-0}
+RECEIVER_CPU=${BENCH_RECEIVER_CPU:-$((NCPU - 1))}
+TIMEOUT=${BENCH_TIMEOUT:-60}
+SENDER_OPTS=
+AFFINITY_OPTS=
+[ "$BENCH_AFFINITY" = auto ] && AFFINITY_OPTS="-a auto"
+if [ -n "$BENCH_ZEROCOPY" ]; then
+    SENDER_OPTS=-z
+    MECHS=${BENCH_MECHS:-"1 2 3 5 6 7"}
+fi
+
+WORKDIR=$(mktemp -d)
+trap 'rm -rf "$WORKDIR"' EXIT
+
+# 沒有 taskset 時就不綁定 CPU
+pin() {
+    local cpu=$1
+    shift
+    if [ -z "$AFFINITY_OPTS" ] && command -v taskset >/dev/null 2>&1; then
+        taskset -c "$cpu" "$@"
+    else
+        "$@"
+    fi
+}
+
+# 產生 COUNT 行、每行 (含換行) 剛好 size bytes 的輸入檔
+gen_input() {
+    local size=$1 file=$2
+    awk -v n="$COUNT" -v s="$size" 'BEGIN {
+        line = sprintf("%*s", s - 1, "")
+        gsub(/ /, "x", line)
+        for (i = 0; i < n; i++)
+            print line
+    }' > "$file"
+}
+
+[ -n "$BENCH_CSV" ] && echo "mechanism,sync,size,rate,batch_us,messages,bytes,elapsed_s,msg_per_s,bytes_per_s,p50_ns,p90_ns,p99_ns,p999_ns,max_ns" > "$BENCH_CSV"
+
+if [ "$BENCH_AFFINITY" = auto ]; then
+    echo "automatic cpu placement, $COUNT messages per run, window $WINDOW"
+else
+    echo "sender cpu $SENDER_CPU, receiver cpu $RECEIVER_CPU, $COUNT messages per run, window $WINDOW"
+fi
+printf "%-5s %-6s %7s %8s %6s %9s %12s %10s %10s %10s %10s %10s\n" \
+    mech sync size rate batch msgs "msg/s" "MB/s" "p50(us)" "p99(us)" "p99.9(us)" "max(us)"
+
+for size in $SIZES; do
+    input=$WORKDIR/input_$size.txt
+    gen_input "$size" "$input"
+    for mech in $MECHS; do
+        for sync in $SYNCS; do
+            for rate in $RATES; do
+                # 打包只有 mechanism 1 支援，其他 mechanism 只測不打包
+                batches=0
+                [ "$mech" = 1 ] && batches=$BATCHES
+                for batch in $batches; do
+                    out=$WORKDIR/receiver.out
+                    pin "$RECEIVER_CPU" timeout "$TIMEOUT" ./receiver -Q $AFFINITY_OPTS -s "$sync" -d 0 -w "$WINDOW" -f csv "$mech" > "$out" 2>&1 &
+                    receiver=$!
+                    sleep 0.2
+                    pin "$SENDER_CPU" timeout "$TIMEOUT" ./sender -Q $SENDER_OPTS -b "$batch" $AFFINITY_OPTS -s "$sync" -r "$rate" "$mech" "$input" > /dev/null 2>&1
+                    wait "$receiver"
+
+                    # receiver 的最後一行是 CSV 結果
+                    result=$(tail -n 1 "$out")
+                    case "$result" in
+                        "$mech",*) ;;
+                        *)
+                            printf "%-5s %-6s %7s %8s %6s %9s\n" "$mech" "$sync" "$size" "$rate" "$batch" "FAILED"
+                            continue
+                            ;;
+                    esac
+                    [ -n "$BENCH_CSV" ] && echo "$result" | awk -F, -v s="$size" -v r="$rate" -v b="$batch" \
+                        'BEGIN { OFS = "," } { print $1, $2, s, r, b, $3, $4, $5, $6, $7, $8, $9, $10, $11, $12 }' >> "$BENCH_CSV"
+                    echo "$result" | awk -F, -v s="$size" -v r="$rate" -v b="$batch" '{
+                        printf "%-5s %-6s %7s %8s %6s %9s %12.1f %10.2f %10.1f %10.1f %10.1f %10.1f\n",
+                            $1, $2, s, r, b, $3, $6, $7 / 1e6, $8 / 1e3, $10 / 1e3, $11 / 1e3, $12 / 1e3
+                    }'
+                done
+            done
+        done
+    done
+done
\ No newline at end of file
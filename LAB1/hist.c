@@ -0,0 +1,69 @@
+#include <string.h>
+#include "hist.h"
+
+// 小於 2 * HIST_SUB 的值各自一個桶；更大的值保留最高的 HIST_SUB_BITS + 1 個位元
+static int bucket_of(uint64_t value)
+{
+    if (value < 2 * HIST_SUB)
+        return (int)value;
+
+    int msb = 63 - __builtin_clzll(value);
+    int shift = msb - HIST_SUB_BITS;
+    return shift * HIST_SUB + (int)(value >> shift);
+}
+
+// 回傳桶中可能的最大值 (HDR histogram 的 highest equivalent value)
+static uint64_t bucket_upper(int idx)
+{
+    if (idx < 2 * HIST_SUB)
+        return idx;
+
+    int shift = idx / HIST_SUB - 1;
+    uint64_t mant = idx % HIST_SUB + HIST_SUB;
+    return ((mant + 1) << shift) - 1;
+}
+
+void hist_init(hist_t* hist)
+{
+    memset(hist, 0, sizeof(*hist));
+    hist->min = UINT64_MAX;
+}
+
+void hist_record(hist_t* hist, uint64_t value)
+{
+    hist->counts[bucket_of(value)]++;
+    hist->total++;
+    hist->sum += value;
+    if (value < hist->min)
+        hist->min = value;
+    if (value > hist->max)
+        hist->max = value;
+}
+
+// percentile 以 0 ~ 100 表示；結果不會超過實際記錄到的最大值
+uint64_t hist_percentile(const hist_t* hist, double percentile)
+{
+    if (hist->total == 0)
+        return 0;
+
+    uint64_t rank = (uint64_t)(percentile / 100.0 * hist->total + 0.5);
+    if (rank < 1)
+        rank = 1;
+
+    uint64_t seen = 0;
+    for (int i = 0; i < HIST_BUCKETS; ++i)
+    {
+        seen += hist->counts[i];
+        if (seen >= rank)
+        {
+            uint64_t value = bucket_upper(i);
+            return value < hist->max ? value : hist->max;
+        }
+    }
+    return hist->max;
+}
+
+double hist_mean(const hist_t* hist)
+{
+    return hist->total ? hist->sum / hist->total : 0.0;
+}
\ No newline at end of file
@@ -0,0 +1,25 @@
+#ifndef HIST_H
+#define HIST_H
+#include <stdint.h>
+
+// HDR 風格的對數分桶 histogram：每個 2 的次方區間再細分成 HIST_SUB 個桶，
+// 相對誤差約 1/HIST_SUB，任何 64 位元的值都只需要固定大小的陣列
+#define HIST_SUB_BITS 4
+#define HIST_SUB (1 << HIST_SUB_BITS)
+#define HIST_BUCKETS ((64 - HIST_SUB_BITS) * HIST_SUB + 2 * HIST_SUB)
+
+typedef struct
+{
+    uint64_t counts[HIST_BUCKETS];
+    uint64_t total;
+    uint64_t min;
+    uint64_t max;
+    double sum;
+} hist_t;
+
+void hist_init(hist_t* hist);
+void hist_record(hist_t* hist, uint64_t value);
+uint64_t hist_percentile(const hist_t* hist, double percentile);
+double hist_mean(const hist_t* hist);
+
+#endif
\ No newline at end of file
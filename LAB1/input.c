@@ -0,0 +1,220 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include "input.h"
+
+/**
+ * 解析 "strict" 或 "wfq[:w0,w1,...]"，沒給的權重為 1
+ * 要在 inputs_open 之前呼叫 (權重先存起來)
+ */
+int inputs_parse_policy(inputs_t* in, const char* arg)
+{
+    for (int i = 0; i < INPUT_MAX_STREAMS; ++i)
+        in->streams[i].weight = 1;
+    if (strcmp(arg, "strict") == 0)
+    {
+        in->policy = SCHED_STRICT;
+        return 0;
+    }
+    if (strncmp(arg, "wfq", 3) != 0 || (arg[3] != '\0' && arg[3] != ':'))
+        return -1;
+
+    in->policy = SCHED_WFQ;
+    const char* p = arg[3] == ':' ? arg + 4 : arg + 3;
+    for (int i = 0; *p && i < INPUT_MAX_STREAMS; ++i)
+    {
+        char* end;
+        long weight = strtol(p, &end, 10);
+        if (end == p || weight < 1 || (*end != ',' && *end != '\0'))
+            return -1;
+        in->streams[i].weight = (int)weight;
+        p = *end == ',' ? end + 1 : end;
+    }
+    return 0;
+}
+
+/**
+ * 開啟所有輸入檔；readahead 為 1 時一般檔案交給 reader thread 在背景讀
+ * (zero-copy 模式直接 mmap 輸入檔，不需要)
+ */
+void inputs_open(inputs_t* in, char* const files[], int count, long quantum, int readahead)
+{
+    in->count = count;
+    in->current = count - 1;    // 第一次挑選時輪到 stream 0
+    in->quantum = quantum;
+    for (int i = 0; i < count; ++i)
+    {
+        input_t* s = &in->streams[i];
+        s->fp = fopen(files[i], "r");
+        if (s->fp == NULL)
+        {
+            perror("fopen failed");
+            exit(1);
+        }
+        // poll 看不到 stdio 緩衝區裡的資料：pipe / 終端機不使用緩衝，
+        // 否則已經讀進緩衝區的紀錄會等到下一次有新輸入才被送出
+        struct stat st;
+        int regular = fstat(fileno(s->fp), &st) == 0 && S_ISREG(st.st_mode);
+        if (!regular)
+            setvbuf(s->fp, NULL, _IONBF, 0);
+        s->ra = regular && readahead ? ra_open(fileno(s->fp)) : NULL;
+        s->line = NULL;
+        s->buf = NULL;
+        s->cap = 0;
+        s->len = -1;
+        s->done = 0;
+        s->deficit = 0;
+    }
+}
+
+// 需要讀下一筆紀錄的 stream (還沒結束、也沒有預讀好的紀錄)
+static int wants_input(const input_t* s)
+{
+    return !s->done && s->len == -1;
+}
+
+/**
+ * 填入還需要輸入的 stream 的 fd，回傳個數
+ * 已經有任何一個 stream 預讀好紀錄時回傳 0，表示現在就有東西可以送
+ */
+int inputs_pollfds(inputs_t* in, struct pollfd* fds)
+{
+    int n = 0;
+    for (int i = 0; i < in->count; ++i)
+    {
+        // reader thread 負責的一般檔案隨時都讀得到下一行
+        if (in->streams[i].len != -1 || (in->streams[i].ra != NULL && wants_input(&in->streams[i])))
+            return 0;
+        if (wants_input(&in->streams[i]))
+        {
+            fds[n].fd = fileno(in->streams[i].fp);
+            fds[n].events = POLLIN;
+            fds[n].revents = 0;
+            n++;
+        }
+    }
+    return n;
+}
+
+// 預讀可以讀的 stream，回傳有紀錄可送的 stream 數
+static int refill(inputs_t* in, int timeout_ms)
+{
+    struct pollfd fds[INPUT_MAX_STREAMS];
+    int idx[INPUT_MAX_STREAMS];
+    int n = 0, ready = 0;
+    for (int i = 0; i < in->count; ++i)
+    {
+        input_t* s = &in->streams[i];
+        if (s->ra != NULL && wants_input(s))
+        {
+            s->len = ra_next(s->ra, &s->line);
+            s->done = s->len == -1;
+        }
+        if (s->len != -1)
+            ready++;
+        else if (wants_input(s))
+        {
+            fds[n].fd = fileno(in->streams[i].fp);
+            fds[n].events = POLLIN;
+            idx[n++] = i;
+        }
+    }
+    if (n == 0)
+        return ready;
+
+    // 已經有紀錄可送就不等，只看看其他 stream 是不是也準備好了
+    if (poll(fds, n, ready ? 0 : timeout_ms) == -1 && errno != EINTR)
+    {
+        perror("poll failed");
+        exit(1);
+    }
+    for (int k = 0; k < n; ++k)
+    {
+        if (!(fds[k].revents & (POLLIN | POLLHUP | POLLERR)))
+            continue;
+        input_t* s = &in->streams[idx[k]];
+        s->len = getline(&s->buf, &s->cap, s->fp);
+        s->line = s->buf;
+        if (s->len == -1)
+            s->done = 1;
+        else
+            ready++;
+    }
+    return ready;
+}
+
+static int all_done(const inputs_t* in)
+{
+    for (int i = 0; i < in->count; ++i)
+        if (!in->streams[i].done || in->streams[i].len != -1)
+            return 0;
+    return 1;
+}
+
+/**
+ * deficit round robin：輪到的 stream 每一輪多 weight * quantum bytes 的額度，
+ * 額度夠送下一筆紀錄才送，所以長期下來各 stream 的頻寬與權重成正比
+ * 沒有資料的 stream 額度歸零，不能把沒用到的頻寬存起來之後一次用掉
+ */
+static int pick_wfq(inputs_t* in)
+{
+    for (;;)
+    {
+        input_t* s = &in->streams[in->current];
+        if (s->len == -1)
+            s->deficit = 0;
+        else if (s->deficit >= s->len + 1)
+            return in->current;
+
+        in->current = (in->current + 1) % in->count;
+        input_t* next = &in->streams[in->current];
+        if (next->len != -1)
+            next->deficit += next->weight * in->quantum;
+    }
+}
+
+/**
+ * 依排程策略挑下一個要送的 stream，紀錄在 streams[idx].line / len
+ * 全部送完回傳 -1；block 為 0 且目前沒有任何紀錄可送回傳 -2
+ */
+int inputs_next(inputs_t* in, int block)
+{
+    for (;;)
+    {
+        int ready = refill(in, block ? -1 : 0);
+        if (all_done(in))
+            return -1;
+        if (ready == 0)
+        {
+            if (!block)
+                return -2;
+            continue;
+        }
+
+        if (in->policy == SCHED_WFQ)
+            return pick_wfq(in);
+        for (int i = 0; i < in->count; ++i)
+            if (in->streams[i].len != -1)
+                return i;
+    }
+}
+
+// 紀錄送出之後呼叫，扣掉 WFQ 額度並讓下一次重新預讀
+void inputs_consume(inputs_t* in, int idx)
+{
+    input_t* s = &in->streams[idx];
+    s->deficit -= s->len + 1;
+    s->len = -1;
+}
+
+void inputs_close(inputs_t* in)
+{
+    for (int i = 0; i < in->count; ++i)
+    {
+        if (in->streams[i].ra != NULL)
+            ra_close(in->streams[i].ra);
+        fclose(in->streams[i].fp);
+        free(in->streams[i].buf);
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef INPUT_H
+#define INPUT_H
+#include <stdio.h>
+#include <poll.h>
+#include <sys/types.h>
+#include "readahead.h"
+
+#define INPUT_MAX_STREAMS 16    // 一個 sender 最多同時送幾個輸入檔
+
+#define SCHED_STRICT 0          // 編號小的 stream 優先，有資料就先送
+#define SCHED_WFQ 1             // 依權重分配頻寬 (deficit round robin)
+
+// 一個輸入檔，預先讀好下一筆紀錄才知道它是否有資料可以送
+typedef struct
+{
+    FILE* fp;
+    readahead_t* ra;    // 一般檔案由 reader thread 在背景讀，NULL 代表以 getline 讀
+    const char* line;   // 預讀的紀錄，沒有 '\0' 結尾
+    char* buf;          // getline 的緩衝區
+    size_t cap;
+    ssize_t len;        // 預讀的紀錄長度，-1 代表還沒有
+    int done;
+    long deficit;       // WFQ：這一輪還可以送的 bytes
+    int weight;
+} input_t;
+
+typedef struct
+{
+    input_t streams[INPUT_MAX_STREAMS];
+    int count;
+    int policy;
+    int current;        // WFQ：目前輪到的 stream
+    long quantum;       // WFQ：權重 1 每一輪分到的 bytes
+} inputs_t;
+
+int inputs_parse_policy(inputs_t* in, const char* arg);
+void inputs_open(inputs_t* in, char* const files[], int count, long quantum, int readahead);
+int inputs_next(inputs_t* in, int block);
+void inputs_consume(inputs_t* in, int idx);
+int inputs_pollfds(inputs_t* in, struct pollfd* fds);
+void inputs_close(inputs_t* in);
+
+#endif
@@ -0,0 +1,227 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <mqueue.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include "kxport.h"
+
+#define CONNECT_RETRIES 50      // sender 比 receiver 先啟動時，每 100ms 重試一次
+
+// 各種 kernel 物件都用 key 命名，sender 與 receiver 才找得到同一個
+static void kx_name(char* buf, size_t cap, const char* fmt, key_t key)
+{
+    snprintf(buf, cap, fmt, (unsigned)key);
+}
+
+/**
+ * 開啟 (必要時建立) POSIX message queue
+ * 內容依 priority 排序，同一個 priority 之內是 FIFO
+ */
+int kx_mq_open(key_t key, size_t msgsize)
+{
+    char name[64];
+    struct mq_attr attr = {0};
+    attr.mq_maxmsg = KX_MQ_DEPTH;
+    attr.mq_msgsize = msgsize;
+    kx_name(name, sizeof(name), "/mailbox-%08x", key);
+
+    mqd_t mq = mq_open(name, O_RDWR | O_CREAT, 0666, &attr);
+    if (mq == (mqd_t)-1)
+    {
+        perror("mq_open failed");
+        exit(1);
+    }
+    return mq;
+}
+
+void kx_mq_unlink(key_t key)
+{
+    char name[64];
+    kx_name(name, sizeof(name), "/mailbox-%08x", key);
+    mq_unlink(name);
+}
+
+static socklen_t seq_address(struct sockaddr_un* addr, key_t key)
+{
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    kx_name(addr->sun_path + 1, sizeof(addr->sun_path) - 1, "mailbox-seq-%08x", key);
+    return offsetof(struct sockaddr_un, sun_path) + 1 + strlen(addr->sun_path + 1);
+}
+
+// receiver：等一個 sender 連上 SOCK_SEQPACKET socket，每次 read 剛好是一則訊息
+int kx_seq_accept(key_t key)
+{
+    struct sockaddr_un addr;
+    socklen_t len = seq_address(&addr, key);
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+    if (fd == -1 || bind(fd, (struct sockaddr*)&addr, len) == -1 || listen(fd, 1) == -1)
+    {
+        perror("bind seqpacket socket failed");
+        exit(1);
+    }
+
+    int conn = accept(fd, NULL, NULL);
+    if (conn == -1)
+    {
+        perror("accept failed");
+        exit(1);
+    }
+    // 只服務一個 sender，連上之後 abstract 名稱就可以釋放
+    close(fd);
+    return conn;
+}
+
+int kx_seq_connect(key_t key)
+{
+    struct sockaddr_un addr;
+    socklen_t len = seq_address(&addr, key);
+
+    for (int tries = 0; ; ++tries)
+    {
+        int fd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+        if (fd == -1)
+        {
+            perror("socket failed");
+            exit(1);
+        }
+        if (connect(fd, (struct sockaddr*)&addr, len) == 0)
+            return fd;
+        close(fd);
+        if (tries == CONNECT_RETRIES)
+        {
+            perror("connect to receiver failed");
+            exit(1);
+        }
+        usleep(100000);
+    }
+}
+
+/**
+ * 以 /tmp 下的 FIFO 會合，open 會等到另一端也打開為止
+ * sender 多配置一組 page 對齊的 slot，數量比 pipe 最多能放的 buffer 數多一個
+ */
+kx_pipe_t* kx_pipe_open(key_t key, int writer)
+{
+    char path[64];
+    kx_name(path, sizeof(path), "/tmp/mailbox-%08x.fifo", key);
+    if (mkfifo(path, 0666) == -1 && errno != EEXIST)
+    {
+        perror("mkfifo failed");
+        exit(1);
+    }
+
+    kx_pipe_t* pipe = calloc(1, sizeof(kx_pipe_t));
+    if (pipe == NULL)
+    {
+        perror("calloc pipe failed");
+        exit(1);
+    }
+    pipe->fd = open(path, writer ? O_WRONLY : O_RDONLY);
+    if (pipe->fd == -1)
+    {
+        perror("open fifo failed");
+        exit(1);
+    }
+    if (!writer)
+        return pipe;
+
+    // 放大失敗 (超過 fs.pipe-max-size) 就沿用目前的容量
+    fcntl(pipe->fd, F_SETPIPE_SZ, KX_PIPE_SIZE);
+    // pipe 的 buffer 以 page 為單位，slot 的大小跟著系統的 page 大小 (4K / 16K / 64K)
+    int size = fcntl(pipe->fd, F_GETPIPE_SZ);
+    pipe->slot_size = getpagesize();
+    pipe->count = (size > 0 ? size : KX_PIPE_SIZE) / pipe->slot_size + 1;
+    pipe->slots = mmap(NULL, pipe->count * pipe->slot_size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (pipe->slots == MAP_FAILED)
+    {
+        perror("mmap pipe slots failed");
+        exit(1);
+    }
+    return pipe;
+}
+
+// 把 [標頭][內容] 組進下一個 slot，再以 vmsplice 把整個 page 交給 pipe，kernel 不再複製一次
+void kx_pipe_send(kx_pipe_t* pipe, const msg_hdr_t* hdr, const char* data)
+{
+    char* slot = pipe->slots + pipe->next * pipe->slot_size;
+    size_t room = pipe->slot_size - sizeof(*hdr);
+    size_t len = hdr->len < room ? hdr->len : room;
+    memcpy(slot, hdr, sizeof(*hdr));
+    ((msg_hdr_t*)slot)->len = len;
+    memcpy(slot + sizeof(*hdr), data, len);
+    pipe->next = (pipe->next + 1) % pipe->count;
+
+    struct iovec iov = {slot, sizeof(*hdr) + len};
+    while (iov.iov_len > 0)
+    {
+        ssize_t n = vmsplice(pipe->fd, &iov, 1, 0);
+        if (n == -1)
+        {
+            if (errno == EINTR)
+                continue;
+            perror("vmsplice failed");
+            exit(1);
+        }
+        iov.iov_base = (char*)iov.iov_base + n;
+        iov.iov_len -= n;
+    }
+}
+
+static int read_full(int fd, void* buf, size_t len)
+{
+    size_t done = 0;
+    while (done < len)
+    {
+        ssize_t n = read(fd, (char*)buf + done, len - done);
+        if (n == 0 || (n == -1 && errno != EINTR))
+            return -1;
+        if (n > 0)
+            done += n;
+    }
+    return 0;
+}
+
+// pipe 是 byte stream，先讀固定長度的標頭才知道內容有多長；sender 結束回傳 -1
+int kx_pipe_recv(kx_pipe_t* pipe, msg_hdr_t* hdr, char* data, size_t cap)
+{
+    if (read_full(pipe->fd, hdr, sizeof(*hdr)) == -1)
+        return -1;
+    size_t len = hdr->len < cap ? hdr->len : cap;
+    if (read_full(pipe->fd, data, len) == -1)
+        return -1;
+    // 放不下的部分讀掉丟棄，stream 才不會錯位
+    char skip[256];
+    for (size_t rest = hdr->len - len; rest > 0; )
+    {
+        size_t n = rest < sizeof(skip) ? rest : sizeof(skip);
+        if (read_full(pipe->fd, skip, n) == -1)
+            return -1;
+        rest -= n;
+    }
+    hdr->len = len;
+    return (int)len;
+}
+
+void kx_pipe_close(kx_pipe_t* pipe, key_t key, int remove)
+{
+    char path[64];
+    close(pipe->fd);
+    if (pipe->slots != NULL)
+        munmap(pipe->slots, pipe->count * pipe->slot_size);
+    free(pipe);
+    if (remove)
+    {
+        kx_name(path, sizeof(path), "/tmp/mailbox-%08x.fifo", key);
+        unlink(path);
+    }
+}
@@ -0,0 +1,33 @@
+#ifndef KXPORT_H
+#define KXPORT_H
+#include <stddef.h>
+#include <sys/types.h>
+#include "msghdr.h"
+
+// mechanism 5 ~ 7 直接交給 kernel 傳送，每則訊息是連續的 [msg_hdr_t][內容]
+#define KX_MQ_DEPTH 10          // POSIX message queue 的長度 (fs.mqueue.msg_max 預設上限)
+#define KX_PIPE_SIZE (1 << 20)  // pipe 的容量，會被 fs.pipe-max-size 限制
+
+// vmsplice 之後 pipe 只是引用 sender 的 page，
+// 所以每則訊息用不同的 slot，繞一圈回來時舊的內容一定已經被 receiver 讀走
+typedef struct
+{
+    int fd;
+    char* slots;
+    size_t slot_size;   // 一個 page：每則訊息剛好佔 pipe 的一個 buffer
+    size_t count;
+    size_t next;
+} kx_pipe_t;
+
+int kx_mq_open(key_t key, size_t msgsize);
+void kx_mq_unlink(key_t key);
+
+int kx_seq_accept(key_t key);
+int kx_seq_connect(key_t key);
+
+kx_pipe_t* kx_pipe_open(key_t key, int writer);
+void kx_pipe_send(kx_pipe_t* pipe, const msg_hdr_t* hdr, const char* data);
+int kx_pipe_recv(kx_pipe_t* pipe, msg_hdr_t* hdr, char* data, size_t cap);
+void kx_pipe_close(kx_pipe_t* pipe, key_t key, int remove);
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef MAILBOX_H
+#define MAILBOX_H
+#include <stddef.h>
+#include <sys/types.h>
+#include <sys/ipc.h>
+#include <sys/sem.h>
+#include "ring.h"
+#include "mbsync.h"
+#include "batch.h"
+#include "msghdr.h"
+#include "mpmc.h"
+#include "zc.h"
+#include "mux.h"
+#include "kxport.h"
+#include "shmseg.h"
+#include "affinity.h"
+#include "bcast.h"
+
+typedef struct
+{
+    int flag;      // 1 for message passing, 2 for shared memory, 3 for shared memory ring buffer, 4 for multi-producer / multi-consumer queue,
+                   // 5 for POSIX message queue, 6 for unix seqpacket socket, 7 for pipe (vmsplice),
+                   // 8 for seqlock broadcast (receiver 只讀最新的值)
+    union
+    {
+        int msqid; //for system V api. You can replace it with struecture for POSIX api
+        char* shm_addr;
+        ring_t* ring;
+        int fd;             // POSIX message queue 或 unix socket
+        kx_pipe_t* pipe;
+    }storage;
+    mbsync_t sync; // sender 與 receiver 交握用的同步機制 (System V semaphore 或 futex)
+    batch_t* batch; // mechanism 1 把多則訊息打包成一個 frame 的狀態
+    mpmc_port_t mpmc; // mechanism 4 在共用 queue 中的 lane 與 sender / receiver 數
+    zc_map_t zc;    // zero-copy 模式下兩邊共用的輸入檔 mapping
+    mux_t* mux;     // receiver：非 NULL 時以 epoll 同時服務多個 ring (mechanism 3)
+    int notify_fd;  // sender：放入 ring 之後用來叫醒 epoll receiver 的 eventfd，-1 代表不需要
+    ring_t* reply;  // RPC 模式：receiver 把回覆放回 sender 的 ring，NULL 代表單向
+    bcast_port_t bcast; // mechanism 8 的 seqlock 共享記憶體與 receiver 的讀取統計
+} mailbox_t;
+
+
+typedef struct
+{
+    long mtype;       // 訊息類型
+    msg_hdr_t hdr;    // 送出時間與長度
+    char data[MAX];  // 訊息內容
+} message_t;
+
+// POSIX message queue (mechanism 5) 把 &hdr 開始的 [標頭][內容] 當成一段連續的資料直接交給 kernel
+_Static_assert(offsetof(message_t, data) == offsetof(message_t, hdr) + sizeof(msg_hdr_t),
+               "message data must follow the header");
+#define MESSAGE_WIRE_MAX (sizeof(msg_hdr_t) + MAX)
+
+
+union semun
+{
+    int val;                // Value for SETVAL
+    struct semid_ds *buf;   // Buffer for IPC_STAT, IPC_SET
+    unsigned short *array;  // Array for GETALL, SETALL
+    struct seminfo *__buf;  // Buffer for IPC_INFO (Linux-specific)
+};
+
+// 產生 IPC key；"progfile" 不存在時 ftok 會回傳 -1，
+// 讓所有 proj_id 都撞在同一個 key 上，所以改用目前目錄
+static inline key_t mailbox_key(int proj_id)
+{
+    key_t key = ftok("progfile", proj_id);
+    if (key == -1)
+        key = ftok(".", proj_id);
+    return key;
+}
+
+#endif
\ No newline at end of file
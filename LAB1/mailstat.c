@@ -0,0 +1,105 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/shm.h>
+#include "mailbox.h"
+#include "stats.h"
+#define USAGE "Usage: %s [-i seconds] [-c count]\n"
+
+// 上一次取樣時每個 slot 的計數，用來算這段時間的速率
+typedef struct
+{
+    int32_t pid;
+    uint64_t counters[STAT_COUNT];
+} sample_t;
+
+static const char* role_name(int32_t role)
+{
+    return role == ROLE_SENDER ? "sender" : role == ROLE_RECEIVER ? "receiver" : "?";
+}
+
+/**
+ * 附加到 sender / receiver 共用的統計頁，每隔 interval 秒印出每個行程的速率：
+ * 訊息數、bytes、buffer 滿 / 空而等待的次數、spin 次數與 FUTEX_WAIT 次數
+ * 不需要重新啟動 sender / receiver，隨時可以開始或結束觀察
+ */
+int main(int argc, char* argv[])
+{
+    double interval = 1.0;
+    long count = 0;
+    int opt;
+    // 選項：-i seconds   取樣間隔 (預設 1 秒)
+    //       -c count     印出 count 次後結束 (預設 0：一直執行)
+    while ((opt = getopt(argc, argv, "i:c:")) != -1)
+    {
+        if (opt == 'i' && (interval = atof(optarg)) > 0)
+            continue;
+        if (opt == 'c' && (count = atol(optarg)) >= 0)
+            continue;
+        fprintf(stderr, USAGE, argv[0]);
+        exit(1);
+    }
+
+    stats_page_t* page = NULL;
+    sample_t prev[STATS_SLOTS] = {{0}};
+    uint64_t prev_ns = monotonic_ns();
+    struct timespec ts = {(time_t)interval, (long)((interval - (time_t)interval) * 1e9)};
+
+    printf("%-8s %-8s %-9s %4s %12s %12s %10s %10s %10s %12s %10s\n",
+           "time", "pid", "role", "mech", "messages", "msg/s", "MB/s", "full/s", "empty/s", "spins/s", "sleeps/s");
+    for (long n = 0; count == 0 || n < count; ++n)
+    {
+        nanosleep(&ts, NULL);
+        // sender / receiver 還沒啟動過，統計頁不存在
+        if (page == NULL && (page = stats_map(mailbox_key(71), 0)) == NULL)
+        {
+            printf("No mailbox statistics yet, waiting for a sender or receiver\n");
+            fflush(stdout);
+            continue;
+        }
+
+        uint64_t now = monotonic_ns();
+        double elapsed = (now - prev_ns) / 1e9;
+        time_t wall = time(NULL);
+        char clock[16];
+        strftime(clock, sizeof(clock), "%H:%M:%S", localtime(&wall));
+
+        int shown = 0;
+        for (int i = 0; i < STATS_SLOTS; ++i)
+        {
+            stats_slot_t* slot = &page->slots[i];
+            int32_t pid = atomic_load(&slot->pid);
+            if (!stats_alive(pid))
+            {
+                prev[i].pid = 0;
+                continue;
+            }
+
+            uint64_t cur[STAT_COUNT];
+            for (int c = 0; c < STAT_COUNT; ++c)
+                cur[c] = atomic_load_explicit(&slot->counters[c], memory_order_relaxed);
+            // 新登記的行程 (或計數剛被歸零) 從這一次開始算
+            int fresh = prev[i].pid != pid || cur[STAT_MESSAGES] < prev[i].counters[STAT_MESSAGES];
+            double rate[STAT_COUNT];
+            for (int c = 0; c < STAT_COUNT; ++c)
+                rate[c] = fresh ? 0.0 : (cur[c] - prev[i].counters[c]) / elapsed;
+
+            printf("%-8s %-8d %-9s %4d %12llu %12.1f %10.2f %10.1f %10.1f %12.1f %10.1f\n",
+                   clock, pid, role_name(slot->role), slot->mechanism, (unsigned long long)cur[STAT_MESSAGES],
+                   rate[STAT_MESSAGES], rate[STAT_BYTES] / 1e6, rate[STAT_FULL], rate[STAT_EMPTY],
+                   rate[STAT_SPINS], rate[STAT_SLEEPS]);
+            prev[i].pid = pid;
+            memcpy(prev[i].counters, cur, sizeof(cur));
+            shown++;
+        }
+        if (shown == 0)
+            printf("%-8s no sender or receiver running\n", clock);
+        fflush(stdout);
+        prev_ns = now;
+    }
+    if (page != NULL)
+        shmdt(page);
+    return 0;
+}
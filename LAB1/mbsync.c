@@ -0,0 +1,218 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <sys/sem.h>
+#include "mbsync.h"
+#include "msghdr.h"
+
+union mbsync_semun
+{
+    int val;
+    struct semid_ds *buf;
+    unsigned short *array;
+};
+
+// 只有一顆 CPU 時對方不可能在我們 spin 的同時前進，直接睡眠比較快
+// receiver 的 worker thread 也會呼叫，所以 limit 是 atomic (重複算一次也沒關係)
+int spin_limit(void)
+{
+    static _Atomic int limit = -1;
+    int value = atomic_load_explicit(&limit, memory_order_relaxed);
+    if (value == -1)
+    {
+        value = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? SPIN_LIMIT : 0;
+        atomic_store_explicit(&limit, value, memory_order_relaxed);
+    }
+    return value;
+}
+
+// 共享記憶體跨行程使用，所以不能加 FUTEX_PRIVATE_FLAG
+int futex_wait(_Atomic uint32_t* addr, uint32_t val)
+{
+    stats_add(STAT_SLEEPS, 1);
+    return syscall(SYS_futex, addr, FUTEX_WAIT, val, NULL, NULL, 0);
+}
+
+int futex_wake(_Atomic uint32_t* addr, int n)
+{
+    return syscall(SYS_futex, addr, FUTEX_WAKE, n, NULL, NULL, 0);
+}
+
+// 只在同一個 process 的 thread 之間使用 (例如 pool.c)，可以加 FUTEX_PRIVATE_FLAG 省掉共享 key 的查詢
+int futex_wait_private(_Atomic uint32_t* addr, uint32_t val)
+{
+    stats_add(STAT_SLEEPS, 1);
+    return syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, val, NULL, NULL, 0);
+}
+
+int futex_wake_private(_Atomic uint32_t* addr, int n)
+{
+    return syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, n, NULL, NULL, 0);
+}
+
+// 把命令列上的名稱轉成 backend 編號，無法辨識回傳 -1
+int mbsync_parse(const char* name)
+{
+    if (strcmp(name, "sysv") == 0)
+        return SYNC_SYSV;
+    if (strcmp(name, "futex") == 0)
+        return SYNC_FUTEX;
+    return -1;
+}
+
+// 取得交握用的兩個 semaphore，初始值由 receiver 以 mbsync_set 設定
+void mbsync_open(mbsync_t* sync, int backend, key_t key)
+{
+    sync->backend = backend;
+    sync->semid = -1;
+    sync->shmid = -1;
+    sync->page = NULL;
+    sync->wait_ns = 0;
+
+    if (backend == SYNC_SYSV)
+    {
+        sync->semid = semget(key, 2, 0666 | IPC_CREAT);
+        if (sync->semid == -1)
+        {
+            perror("semget failed");
+            exit(1);
+        }
+    }
+    else
+    {
+        int shmid = shmget(key, sizeof(futex_page_t), 0666 | IPC_CREAT);
+        if (shmid == -1)
+        {
+            perror("shmget futex page failed");
+            exit(1);
+        }
+        sync->page = shmat(shmid, NULL, 0);
+        if (sync->page == (void*)-1)
+        {
+            perror("shmat futex page failed");
+            exit(1);
+        }
+        sync->shmid = shmid;
+    }
+}
+
+/**
+ * 直接設定 semaphore 的值 (SETVAL)
+ * futex 只改 count；waiters 可能已經有先啟動的行程登記在上面，清掉的話就叫不醒它
+ */
+void mbsync_set(mbsync_t* sync, int idx, unsigned int value)
+{
+    if (sync->backend == SYNC_SYSV)
+    {
+        union mbsync_semun sem_union;
+        sem_union.val = value;
+        if (semctl(sync->semid, idx, SETVAL, sem_union) == -1)
+        {
+            perror("semctl failed");
+            exit(1);
+        }
+        return;
+    }
+
+    futex_sem_t* sem = &sync->page->sem[idx];
+    atomic_store(&sem->count, value);
+    if (value > 0 && atomic_load(&sem->waiters) > 0)
+        futex_wake(&sem->count, INT_MAX);
+}
+
+/**
+ * 釋放同步機制
+ * remove 為 1 時 (receiver 最後離開) 順便刪除 futex 所在的共享記憶體，
+ * 下一次執行會拿到全新 (全為 0) 的 page
+ */
+void mbsync_close(mbsync_t* sync, int remove)
+{
+    if (sync->page == NULL)
+        return;
+    shmdt(sync->page);
+    if (remove)
+        shmctl(sync->shmid, IPC_RMID, NULL);
+    sync->page = NULL;
+}
+
+// V 操作：semaphore 加 1，有人在睡才需要 FUTEX_WAKE
+void mbsync_post(mbsync_t* sync, int idx)
+{
+    if (sync->backend == SYNC_SYSV)
+    {
+        struct sembuf sb = {idx, 1, 0};
+        semop(sync->semid, &sb, 1);
+        return;
+    }
+
+    futex_sem_t* sem = &sync->page->sem[idx];
+    atomic_fetch_add(&sem->count, 1);
+    if (atomic_load(&sem->waiters) > 0)
+        futex_wake(&sem->count, 1);
+}
+
+static int try_take(futex_sem_t* sem)
+{
+    uint32_t c = atomic_load(&sem->count);
+    while (c > 0)
+    {
+        if (atomic_compare_exchange_weak(&sem->count, &c, c - 1))
+            return 1;
+    }
+    return 0;
+}
+
+/**
+ * P 操作：先 spin 一小段時間，對方很快就 post 的話完全不需要 system call
+ * 拿不到就表示要等對方：semaphore 0 是 credit (sender 等的是 buffer 有空位)，
+ * 1 是待處理的訊息 (receiver 等的是 buffer 有資料)
+ */
+void mbsync_wait(mbsync_t* sync, int idx)
+{
+    int stall = idx == 0 ? STAT_FULL : STAT_EMPTY;
+    if (sync->backend == SYNC_SYSV)
+    {
+        // 先不阻塞地試一次，真的要等才算一次 stall
+        struct sembuf sb = {idx, -1, IPC_NOWAIT};
+        if (semop(sync->semid, &sb, 1) == 0)
+            return;
+        stats_add(stall, 1);
+        stats_add(STAT_SLEEPS, 1);
+        sb.sem_flg = 0;
+        uint64_t start = monotonic_ns();
+        while (semop(sync->semid, &sb, 1) == -1 && errno == EINTR)
+            ;
+        sync->wait_ns += monotonic_ns() - start;
+        return;
+    }
+
+    futex_sem_t* sem = &sync->page->sem[idx];
+    if (try_take(sem))
+        return;
+    stats_add(stall, 1);
+    for (int spins = 0; spins < spin_limit(); ++spins)
+    {
+        if (try_take(sem))
+            return;
+        cpu_relax();
+    }
+
+    // 累計真正睡眠的時間，spin 階段就拿到的話不計
+    uint64_t start = monotonic_ns();
+    while (!try_take(sem))
+    {
+        // 先登記 waiters 再睡；若 post 已經發生，count 不為 0，FUTEX_WAIT 會立即返回
+        atomic_fetch_add(&sem->waiters, 1);
+        if (futex_wait(&sem->count, 0) == -1 && errno != EAGAIN && errno != EINTR)
+            perror("futex wait failed");
+        atomic_fetch_sub(&sem->waiters, 1);
+    }
+    sync->wait_ns += monotonic_ns() - start;
+}
\ No newline at end of file
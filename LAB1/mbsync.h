@@ -0,0 +1,59 @@
+#ifndef MBSYNC_H
+#define MBSYNC_H
+#include <stdint.h>
+#include <stdatomic.h>
+#include <sys/types.h>
+#include "stats.h"
+
+#define SYNC_SYSV  0    // System V semaphore (semop)
+#define SYNC_FUTEX 1    // 共享記憶體中的 futex word
+
+#define SPIN_LIMIT 1000 // 進入睡眠前先 busy spin 的次數
+#define CACHE_LINE 64
+
+// 放在共享記憶體中的 counting semaphore
+typedef struct
+{
+    _Alignas(CACHE_LINE) _Atomic uint32_t count;    // semaphore 的值，也是 futex word
+    _Atomic uint32_t waiters;                       // 正在 FUTEX_WAIT 的行程數
+} futex_sem_t;
+
+typedef struct
+{
+    futex_sem_t sem[2];
+} futex_page_t;
+
+// sender / receiver 之間交握用的兩個 semaphore (編號 0 和 1)
+typedef struct
+{
+    int backend;            // SYNC_SYSV or SYNC_FUTEX
+    int semid;              // SYNC_SYSV 時使用
+    int shmid;              // SYNC_FUTEX 時 futex page 所在的共享記憶體
+    futex_page_t* page;     // SYNC_FUTEX 時使用
+    uint64_t wait_ns;       // 在 mbsync_wait 中阻塞的累計時間
+} mbsync_t;
+
+static inline void cpu_relax(void)
+{
+    stats_add(STAT_SPINS, 1);
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+int spin_limit(void);
+int futex_wait(_Atomic uint32_t* addr, uint32_t val);
+int futex_wake(_Atomic uint32_t* addr, int n);
+int futex_wait_private(_Atomic uint32_t* addr, uint32_t val);
+int futex_wake_private(_Atomic uint32_t* addr, int n);
+
+int mbsync_parse(const char* name);
+void mbsync_open(mbsync_t* sync, int backend, key_t key);
+void mbsync_set(mbsync_t* sync, int idx, unsigned int value);
+void mbsync_close(mbsync_t* sync, int remove);
+void mbsync_post(mbsync_t* sync, int idx);
+void mbsync_wait(mbsync_t* sync, int idx);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,238 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include "mpmc.h"
+#include "shmseg.h"
+
+/*
+ * 睡眠與喚醒：enq / deq 是在 slot 發佈之前就先搶下的，不能拿來當 futex word。
+ * 改用獨立的喚醒序號，等待的一方先登記 (waiters + 1)、再讀序號、再檢查一次 queue，
+ * 發佈的一方先發佈 slot、再看有沒有人登記，有的話把序號加 1 並 futex_wake。
+ * 兩邊都是 seq_cst，不是發佈的一方看到登記，就是等待的一方在重新檢查時看到 slot，
+ * 所以不會漏掉喚醒，也不需要 timeout
+ */
+
+// 在 word 上有人登記等待時，把序號加 1 並叫醒最多 n 個
+static void wake_seq(_Atomic uint32_t* word, _Atomic uint32_t* waiters, int n)
+{
+    if (atomic_load(waiters) > 0)
+    {
+        atomic_fetch_add(word, 1);
+        futex_wake(word, n);
+    }
+}
+
+// huge 為 1 時使用 huge page，不能用時退回一般 page
+mpmc_t* mpmc_attach(key_t key, int huge)
+{
+    return shm_attach(key, sizeof(mpmc_t), huge, NULL);
+}
+
+void mpmc_detach(mpmc_t* q)
+{
+    shmdt(q);
+}
+
+void mpmc_destroy(key_t key)
+{
+    int shmid = shmget(key, 0, 0666);
+    if (shmid != -1)
+        shmctl(shmid, IPC_RMID, NULL);
+}
+
+// 成功放入回傳 0，lane 滿了回傳 -1
+static int lane_try_push(mpmc_t* q, int lanes, mpmc_lane_t* lane, const msg_hdr_t* hdr, const char* data)
+{
+    uint32_t pos = atomic_load_explicit(&lane->enq, memory_order_relaxed);
+    mpmc_slot_t* slot;
+    for (;;)
+    {
+        uint32_t idx = pos & (MPMC_SLOTS - 1);
+        slot = &lane->slots[idx];
+        uint32_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire) + idx;
+        int32_t diff = (int32_t)(seq - pos);
+        if (diff == 0)
+        {
+            // slot 是空的，搶下這個位置
+            if (atomic_compare_exchange_weak_explicit(&lane->enq, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0)
+            return -1;
+        else
+            pos = atomic_load_explicit(&lane->enq, memory_order_relaxed);
+    }
+
+    size_t len = hdr->len < RING_SLOT_SIZE ? hdr->len : RING_SLOT_SIZE;
+    memcpy(slot->data, data, len);
+    slot->hdr = *hdr;
+    slot->hdr.len = len;
+
+    // 發佈：receiver 看到 seq == pos + 1 才會讀
+    uint32_t idx = pos & (MPMC_SLOTS - 1);
+    atomic_store_explicit(&slot->seq, pos + 1 - idx, memory_order_seq_cst);
+
+    // 先叫醒這條 lane 的 owner；owner 正在忙的話叫醒一個閒著的 receiver 來偷
+    if (atomic_load(&lane->deq_waiters) > 0)
+        wake_seq(&lane->ready, &lane->deq_waiters, INT_MAX);
+    else
+    {
+        for (int i = 0; i < lanes; ++i)
+        {
+            mpmc_lane_t* other = &q->lanes[i];
+            if (other != lane && atomic_load(&other->deq_waiters) > 0)
+            {
+                wake_seq(&other->ready, &other->deq_waiters, INT_MAX);
+                break;
+            }
+        }
+    }
+    return 0;
+}
+
+// 成功取出回傳長度，lane 是空的回傳 -1
+static int lane_try_pop(mpmc_t* q, mpmc_lane_t* lane, msg_hdr_t* hdr, char* data, size_t cap)
+{
+    uint32_t pos = atomic_load_explicit(&lane->deq, memory_order_relaxed);
+    mpmc_slot_t* slot;
+    for (;;)
+    {
+        uint32_t idx = pos & (MPMC_SLOTS - 1);
+        slot = &lane->slots[idx];
+        uint32_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire) + idx;
+        int32_t diff = (int32_t)(seq - (pos + 1));
+        if (diff == 0)
+        {
+            if (atomic_compare_exchange_weak_explicit(&lane->deq, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0)
+            return -1;
+        else
+            pos = atomic_load_explicit(&lane->deq, memory_order_relaxed);
+    }
+
+    size_t len = slot->hdr.len < cap ? slot->hdr.len : cap;
+    memcpy(data, slot->data, len);
+    *hdr = slot->hdr;
+    hdr->len = len;
+
+    // 把 slot 還給 sender：下一輪的 pos + MPMC_SLOTS
+    uint32_t idx = pos & (MPMC_SLOTS - 1);
+    atomic_store_explicit(&slot->seq, pos + MPMC_SLOTS - idx, memory_order_seq_cst);
+    wake_seq(&q->freed, &q->enq_waiters, INT_MAX);
+    return (int)len;
+}
+
+// 依 round-robin 從優先的 lane 開始試著放入，成功回傳 0
+static int try_push_any(mpmc_port_t* port, const msg_hdr_t* hdr, const char* data)
+{
+    for (int i = 0; i < port->lanes; ++i)
+    {
+        int lane = (port->lane + i) % port->lanes;
+        if (lane_try_push(port->q, port->lanes, &port->q->lanes[lane], hdr, data) == 0)
+        {
+            port->lane = (lane + 1) % port->lanes;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/**
+ * sender 以 round-robin 把訊息分散到各個 receiver 的 lane，
+ * 優先的 lane 滿了就改放其他 lane，全部都滿了才睡，任何一條 lane 空出 slot 都會叫醒
+ */
+void mpmc_push(mpmc_port_t* port, const msg_hdr_t* hdr, const char* data)
+{
+    mpmc_t* q = port->q;
+    for (int waited = 0;; waited = 1)
+    {
+        if (try_push_any(port, hdr, data) == 0)
+            return;
+
+        if (!waited)
+            stats_add(STAT_FULL, 1);
+        atomic_fetch_add(&q->enq_waiters, 1);
+        uint32_t seen = atomic_load(&q->freed);
+        if (try_push_any(port, hdr, data) == 0)
+        {
+            atomic_fetch_sub(&q->enq_waiters, 1);
+            return;
+        }
+        futex_wait(&q->freed, seen);
+        atomic_fetch_sub(&q->enq_waiters, 1);
+    }
+}
+
+// sender 送完了：計數加 1，並叫醒所有在睡的 receiver 重新檢查
+void mpmc_finish(mpmc_port_t* port)
+{
+    atomic_fetch_add(&port->q->done, 1);
+    for (int i = 0; i < port->lanes; ++i)
+    {
+        atomic_fetch_add(&port->q->lanes[i].ready, 1);
+        futex_wake(&port->q->lanes[i].ready, INT_MAX);
+    }
+}
+
+// 從自己的 lane 開始把每條 lane 都試一次
+static int try_pop_any(mpmc_port_t* port, msg_hdr_t* hdr, char* data, size_t cap)
+{
+    for (int i = 0; i < port->lanes; ++i)
+    {
+        int lane = (port->lane + i) % port->lanes;
+        int len = lane_try_pop(port->q, &port->q->lanes[lane], hdr, data, cap);
+        if (len != -1)
+            return len;
+    }
+    return -1;
+}
+
+/**
+ * receiver 先取自己的 lane，空的話去偷其他 lane 的訊息
+ * 所有 sender 都送完而且每條 lane 都空了回傳 -1
+ */
+int mpmc_pop(mpmc_port_t* port, msg_hdr_t* hdr, char* data, size_t cap)
+{
+    mpmc_lane_t* own = &port->q->lanes[port->lane];
+    for (int waited = 0;; waited = 1)
+    {
+        for (int spins = 0; spins <= spin_limit(); ++spins)
+        {
+            int len = try_pop_any(port, hdr, data, cap);
+            if (len != -1)
+                return len;
+            cpu_relax();
+        }
+
+        // 登記之後再讀序號與 done，最後再檢查一次 lane
+        // done 要在檢查 lane 之前讀：sender 是放完最後一則才把 done 加 1
+        atomic_fetch_add(&own->deq_waiters, 1);
+        uint32_t seen = atomic_load(&own->ready);
+        uint32_t done = atomic_load(&port->q->done);
+        int len = try_pop_any(port, hdr, data, cap);
+        if (len != -1 || done >= (uint32_t)port->producers)
+        {
+            atomic_fetch_sub(&own->deq_waiters, 1);
+            return len;
+        }
+        if (!waited)
+            stats_add(STAT_EMPTY, 1);
+        futex_wait(&own->ready, seen);
+        atomic_fetch_sub(&own->deq_waiters, 1);
+    }
+}
+
+// receiver 離開，回傳 1 代表自己是最後一個，應該負責刪除共享記憶體
+int mpmc_leave(mpmc_port_t* port)
+{
+    return atomic_fetch_add(&port->q->exited, 1) + 1 >= (uint32_t)port->lanes;
+}
\ No newline at end of file
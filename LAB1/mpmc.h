@@ -0,0 +1,61 @@
+#ifndef MPMC_H
+#define MPMC_H
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <sys/types.h>
+#include "mbsync.h"
+#include "msghdr.h"
+#include "ring.h"
+
+#define MPMC_MAX_LANES 16       // 最多幾個 receiver (每個 receiver 一條 lane)
+#define MPMC_SLOTS 64           // 每條 lane 的 slot 數，必須是 2 的次方
+
+// seq 存的是 (Vyukov 演算法中的 sequence - slot index)，
+// 這樣全為 0 的新共享記憶體就已經是合法的空 queue，不需要額外初始化
+typedef struct
+{
+    _Atomic uint32_t seq;
+    msg_hdr_t hdr;
+    char data[RING_SLOT_SIZE];
+} mpmc_slot_t;
+
+// 一條 lock-free 的 bounded MPMC queue，
+// 平常只有一個 receiver 在取，其他 receiver 沒事做時會來偷
+typedef struct
+{
+    _Alignas(CACHE_LINE) _Atomic uint32_t enq;          // 下一個寫入位置
+    _Alignas(CACHE_LINE) _Atomic uint32_t deq;          // 下一個讀取位置
+    _Alignas(CACHE_LINE) _Atomic uint32_t ready;        // 喚醒序號：有訊息發佈 (或 sender 結束) 而 owner 在睡時加 1，owner 睡眠的 futex word
+    _Atomic uint32_t deq_waiters;                       // 在 ready 上睡的 receiver 數 (0 或 1)
+    _Alignas(CACHE_LINE) mpmc_slot_t slots[MPMC_SLOTS];
+} mpmc_lane_t;
+
+typedef struct
+{
+    _Alignas(CACHE_LINE) _Atomic uint32_t done;     // 已經送完的 sender 數
+    _Atomic uint32_t exited;                        // 已經結束的 receiver 數
+    _Alignas(CACHE_LINE) _Atomic uint32_t freed;    // 喚醒序號：有 slot 空出來而有 sender 在睡時加 1，sender 睡眠的 futex word
+    _Atomic uint32_t enq_waiters;                   // 在 freed 上睡的 sender 數
+    mpmc_lane_t lanes[MPMC_MAX_LANES];
+} mpmc_t;
+
+// 每個行程各自的連線資訊
+typedef struct
+{
+    mpmc_t* q;
+    int lanes;          // receiver 總數，也就是使用中的 lane 數
+    int lane;           // receiver：自己的 lane；sender：下一次優先放入的 lane
+    int producers;      // receiver：要等幾個 sender 送完才結束
+} mpmc_port_t;
+
+mpmc_t* mpmc_attach(key_t key, int huge);
+void mpmc_detach(mpmc_t* q);
+void mpmc_destroy(key_t key);
+
+void mpmc_push(mpmc_port_t* port, const msg_hdr_t* hdr, const char* data);
+void mpmc_finish(mpmc_port_t* port);
+int mpmc_pop(mpmc_port_t* port, msg_hdr_t* hdr, char* data, size_t cap);
+int mpmc_leave(mpmc_port_t* port);
+
+#endif
\ No newline at end of file
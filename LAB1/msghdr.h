@@ -0,0 +1,28 @@
+#ifndef MSGHDR_H
+#define MSGHDR_H
+#include <stdint.h>
+#include <time.h>
+
+// 每則訊息在各種 transport 上都會附帶的標頭
+typedef struct
+{
+    uint64_t stamp;     // sender 送出時的 CLOCK_MONOTONIC 時間 (ns)，用來計算單向延遲
+    uint32_t len;       // 內容的有效長度 (含結尾的 '\0')
+    uint32_t flags;     // MSG_* 旗標，說明內容要怎麼解讀
+    uint32_t stream;    // 屬於 sender 的第幾個輸入檔，receiver 依此分流
+} msg_hdr_t;
+
+#define MAX 1025        // 一則訊息內容的最大長度 (含結尾的 '\0')，所有 transport 共用
+
+#define MSG_ZC  0x1     // 內容是 zc_desc_t，真正的資料在 sender 分享的 mapping 裡
+#define MSG_MAP 0x2     // 內容是 receiver 要 mmap 的檔案路徑
+#define MSG_PARTIAL 0x4    // 一筆超過 MAX 的紀錄被切成多則訊息，後面還有下一段
+
+static inline uint64_t monotonic_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,236 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "mux.h"
+
+#define CONNECT_RETRIES 50      // sender 比 receiver 先啟動時，每 100ms 重試一次
+
+// 以 key 命名的 abstract unix socket，不會在檔案系統留下任何東西
+static socklen_t mux_address(struct sockaddr_un* addr, key_t key)
+{
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    int n = snprintf(addr->sun_path + 1, sizeof(addr->sun_path) - 1, "mailbox-mux-%08x", (unsigned)key);
+    return offsetof(struct sockaddr_un, sun_path) + 1 + n;
+}
+
+static void watch(mux_t* mux, int fd, uint32_t tag)
+{
+    struct epoll_event ev = {.events = EPOLLIN, .data.u32 = tag};
+    if (epoll_ctl(mux->epfd, EPOLL_CTL_ADD, fd, &ev) == -1)
+    {
+        perror("epoll_ctl failed");
+        exit(1);
+    }
+}
+
+mux_t* mux_open(key_t key)
+{
+    mux_t* mux = calloc(1, sizeof(mux_t));
+    if (mux == NULL)
+    {
+        perror("calloc mux failed");
+        exit(1);
+    }
+
+    mux->epfd = epoll_create1(0);
+    // 非阻塞：每一輪都會順便檢查一次，沒有連線時 accept 不能卡住
+    mux->listenfd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK, 0);
+    if (mux->epfd == -1 || mux->listenfd == -1)
+    {
+        perror("mux setup failed");
+        exit(1);
+    }
+
+    struct sockaddr_un addr;
+    socklen_t len = mux_address(&addr, key);
+    if (bind(mux->listenfd, (struct sockaddr*)&addr, len) == -1 || listen(mux->listenfd, 16) == -1)
+    {
+        perror("bind mux socket failed");
+        exit(1);
+    }
+    // channel 編號從 0 開始，listen socket 用不會撞到的 tag
+    watch(mux, mux->listenfd, MUX_MAX_CHANNELS);
+    mux->budget = MUX_BATCH;
+    return mux;
+}
+
+// 加入下一個 channel 的 ring，一開始先當作有資料，第一次取不到時才會登記 eventfd
+void mux_add(mux_t* mux, key_t ring_key, size_t size, int huge)
+{
+    int c = mux->channels++;
+    mux->rings[c] = ring_attach(ring_key, size, huge);
+    mux->keys[c] = ring_key;
+    mux->efds[c] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (mux->efds[c] == -1)
+    {
+        perror("eventfd failed");
+        exit(1);
+    }
+    watch(mux, mux->efds[c], c);
+    mux->ready |= 1ULL << c;
+}
+
+// sender 連上來時先送出自己的 channel 編號，再以 SCM_RIGHTS 取得對應的 eventfd
+static void mux_accept(mux_t* mux)
+{
+    int conn = accept(mux->listenfd, NULL, NULL);
+    if (conn == -1)
+        return;
+
+    int channel;
+    if (read(conn, &channel, sizeof(channel)) == sizeof(channel) &&
+        channel >= 0 && channel < mux->channels)
+    {
+        char control[CMSG_SPACE(sizeof(int))] = {0};
+        struct iovec iov = {&channel, sizeof(channel)};
+        struct msghdr msg = {.msg_iov = &iov, .msg_iovlen = 1,
+                             .msg_control = control, .msg_controllen = sizeof(control)};
+        struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cmsg), &mux->efds[channel], sizeof(int));
+        if (sendmsg(conn, &msg, 0) == -1)
+            perror("send eventfd failed");
+    }
+    close(conn);
+}
+
+/**
+ * 收 epoll 上的事件：新的 sender 連線就 accept，eventfd 就把 ring 標成有資料
+ * timeout 為 -1 時是所有 ring 都空了在這裡睡；為 0 時只是看一眼，不會等
+ */
+static void mux_poll(mux_t* mux, int timeout)
+{
+    if (timeout != 0)
+        stats_add(STAT_EMPTY, 1);
+    struct epoll_event events[MUX_MAX_CHANNELS + 1];
+    int n = epoll_wait(mux->epfd, events, MUX_MAX_CHANNELS + 1, timeout);
+    if (n == -1 && errno != EINTR)
+    {
+        perror("epoll_wait failed");
+        exit(1);
+    }
+
+    for (int i = 0; i < n; ++i)
+    {
+        uint32_t tag = events[i].data.u32;
+        if (tag == MUX_MAX_CHANNELS)
+        {
+            mux_accept(mux);
+            continue;
+        }
+        // 讀出 eventfd 的計數讓它回到未就緒，再把 ring 標成有資料
+        uint64_t count;
+        if (read(mux->efds[tag], &count, sizeof(count)) == -1 && errno != EAGAIN)
+            perror("read eventfd failed");
+        mux->ready |= 1ULL << tag;
+    }
+}
+
+/**
+ * 從任一個有資料的 ring 取出一則訊息，回傳它的 channel
+ * 就緒的 ring 輪流取，每個最多連續 MUX_BATCH 則；全部取完才在 epoll 上睡
+ * 每繞完一輪先不等待地收一次 epoll 事件，ring 一直有資料時新的 sender 也不會連不上
+ */
+int mux_pop(mux_t* mux, msg_hdr_t* hdr, char* data, size_t cap)
+{
+    for (;;)
+    {
+        while (mux->ready)
+        {
+            int c = mux->current;
+            if (mux->ready & (1ULL << c))
+            {
+                if (mux->budget > 0 && ring_try_pop(mux->rings[c], hdr, data, cap) != -1)
+                {
+                    mux->budget--;
+                    return c;
+                }
+                // 取完了才登記通知；登記時發現又有資料就留在 ready 裡等下一輪
+                if (mux->budget > 0 && ring_arm(mux->rings[c]))
+                    mux->ready &= ~(1ULL << c);
+            }
+            mux->current = (c + 1) % mux->channels;
+            mux->budget = MUX_BATCH;
+            if (mux->current == 0)
+                mux_poll(mux, 0);
+        }
+        mux_poll(mux, -1);
+    }
+}
+
+// receiver 結束時刪除所有 ring，下次執行從空的 ring 開始
+void mux_close(mux_t* mux)
+{
+    for (int c = 0; c < mux->channels; ++c)
+    {
+        ring_detach(mux->rings[c]);
+        ring_destroy(mux->keys[c]);
+        close(mux->efds[c]);
+    }
+    close(mux->listenfd);
+    close(mux->epfd);
+    free(mux);
+}
+
+// sender：向 receiver 拿到自己 channel 的 eventfd
+int mux_connect(key_t key, int channel)
+{
+    struct sockaddr_un addr;
+    socklen_t len = mux_address(&addr, key);
+
+    for (int tries = 0; ; ++tries)
+    {
+        int fd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+        if (fd == -1)
+        {
+            perror("socket failed");
+            exit(1);
+        }
+        if (connect(fd, (struct sockaddr*)&addr, len) == 0)
+        {
+            char control[CMSG_SPACE(sizeof(int))];
+            struct iovec iov = {&channel, sizeof(channel)};
+            struct msghdr msg = {.msg_iov = &iov, .msg_iovlen = 1,
+                                 .msg_control = control, .msg_controllen = sizeof(control)};
+            int efd = -1;
+            // sender.c 自己定義了 send()，蓋掉了 libc 的版本，所以用 write
+            if (write(fd, &channel, sizeof(channel)) == sizeof(channel) && recvmsg(fd, &msg, 0) > 0)
+            {
+                struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+                if (cmsg != NULL && cmsg->cmsg_type == SCM_RIGHTS)
+                    memcpy(&efd, CMSG_DATA(cmsg), sizeof(int));
+            }
+            close(fd);
+            if (efd == -1)
+            {
+                fprintf(stderr, "Receiver does not serve channel %d\n", channel);
+                exit(1);
+            }
+            return efd;
+        }
+        close(fd);
+        if (tries == CONNECT_RETRIES)
+        {
+            perror("connect to receiver failed");
+            exit(1);
+        }
+        usleep(100000);
+    }
+}
+
+// sender：放入資料之後，receiver 若已經登記就寫 eventfd 叫醒它的 epoll
+void mux_notify(ring_t* ring, int efd)
+{
+    uint64_t one = 1;
+    if (ring_disarm(ring) && write(efd, &one, sizeof(one)) == -1)
+        perror("write eventfd failed");
+}
@@ -0,0 +1,35 @@
+#ifndef MUX_H
+#define MUX_H
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include "msghdr.h"
+#include "ring.h"
+
+#define MUX_MAX_CHANNELS 64     // 一個 receiver 最多同時服務幾個 ring
+#define MUX_PROJ 128            // channel c 的 ring 使用 proj_id MUX_PROJ + c
+#define MUX_BATCH 32            // 同一個 ring 連續取幾則就換下一個，避免其他 ring 餓死
+
+// 一個 receiver 透過 epoll 同時等待多個 ring，每個 ring 配一個 eventfd
+typedef struct
+{
+    int epfd;
+    int listenfd;                   // sender 從這個 socket 拿到自己 channel 的 eventfd
+    int channels;
+    ring_t* rings[MUX_MAX_CHANNELS];
+    key_t keys[MUX_MAX_CHANNELS];
+    int efds[MUX_MAX_CHANNELS];
+    uint64_t ready;                 // 可能有資料、還沒取完的 channel
+    int current;                    // 正在取的 channel
+    int budget;                     // current 還可以連續取幾則
+} mux_t;
+
+mux_t* mux_open(key_t key);
+void mux_add(mux_t* mux, key_t ring_key, size_t size, int huge);
+int mux_pop(mux_t* mux, msg_hdr_t* hdr, char* data, size_t cap);
+void mux_close(mux_t* mux);
+
+int mux_connect(key_t key, int channel);
+void mux_notify(ring_t* ring, int efd);
+
+#endif
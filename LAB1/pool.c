@@ -0,0 +1,214 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "pool.h"
+
+/*
+ * 睡眠與喚醒的方式和 mpmc.c 相同：enq / deq 在 slot 發佈之前就被 CAS 改掉，不能當 futex word，
+ * 改用獨立的喚醒序號。等待的一方先登記、讀序號、再檢查一次 queue 才睡；
+ * 發佈的一方發佈之後看到有人登記就把序號加 1 並叫醒，不會漏掉喚醒，也不需要 timeout
+ */
+static void wake_seq(_Atomic uint32_t* word, _Atomic uint32_t* waiters)
+{
+    if (atomic_load(waiters) > 0)
+    {
+        atomic_fetch_add(word, 1);
+        futex_wake_private(word, INT_MAX);
+    }
+}
+
+// 把紀錄複製到 slot 的緩衝區，不夠大才 realloc
+static void fill_slot(pool_slot_t* slot, FILE* out, const char* data, size_t len)
+{
+    if (len + 1 > slot->cap)
+    {
+        char* buf = realloc(slot->job.data, len + 1);
+        if (buf == NULL)
+        {
+            perror("realloc failed");
+            exit(1);
+        }
+        slot->job.data = buf;
+        slot->cap = len + 1;
+    }
+    slot->stop = 0;
+    slot->job.out = out;
+    slot->job.len = len;
+    memcpy(slot->job.data, data, len);
+    slot->job.data[len] = '\0';
+}
+
+// 成功放入回傳 0，queue 滿了回傳 -1；data 為 NULL 代表放入結束訊號
+static int queue_try_push(pool_queue_t* q, FILE* out, const char* data, size_t len)
+{
+    uint32_t pos = atomic_load_explicit(&q->enq, memory_order_relaxed);
+    uint32_t idx;
+    for (;;)
+    {
+        idx = pos & (POOL_SLOTS - 1);
+        uint32_t seq = atomic_load_explicit(&q->slots[idx].seq, memory_order_acquire) + idx;
+        int32_t diff = (int32_t)(seq - pos);
+        if (diff == 0)
+        {
+            if (atomic_compare_exchange_weak_explicit(&q->enq, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0)
+            return -1;
+        else
+            pos = atomic_load_explicit(&q->enq, memory_order_relaxed);
+    }
+
+    pool_slot_t* slot = &q->slots[idx];
+    if (data != NULL)
+        fill_slot(slot, out, data, len);
+    else
+        slot->stop = 1;
+    atomic_store_explicit(&slot->seq, pos + 1 - idx, memory_order_seq_cst);
+    wake_seq(&q->ready, &q->deq_waiters);
+    return 0;
+}
+
+// 搶下一個已發佈的 slot，queue 是空的回傳 NULL；處理完要用 queue_release 還回去
+static pool_slot_t* queue_try_claim(pool_queue_t* q, uint32_t* claimed)
+{
+    uint32_t pos = atomic_load_explicit(&q->deq, memory_order_relaxed);
+    for (;;)
+    {
+        uint32_t idx = pos & (POOL_SLOTS - 1);
+        uint32_t seq = atomic_load_explicit(&q->slots[idx].seq, memory_order_acquire) + idx;
+        int32_t diff = (int32_t)(seq - (pos + 1));
+        if (diff == 0)
+        {
+            if (atomic_compare_exchange_weak_explicit(&q->deq, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0)
+            return NULL;
+        else
+            pos = atomic_load_explicit(&q->deq, memory_order_relaxed);
+    }
+    *claimed = pos;
+    return &q->slots[pos & (POOL_SLOTS - 1)];
+}
+
+// 把 slot 還給 receive loop：下一輪的 pos + POOL_SLOTS
+static void queue_release(pool_queue_t* q, uint32_t pos)
+{
+    uint32_t idx = pos & (POOL_SLOTS - 1);
+    atomic_store_explicit(&q->slots[idx].seq, pos + POOL_SLOTS - idx, memory_order_seq_cst);
+    wake_seq(&q->freed, &q->enq_waiters);
+}
+
+// queue 滿了表示 worker 跟不上，receive loop 只好等
+static void queue_push(pool_queue_t* q, FILE* out, const char* data, size_t len)
+{
+    while (queue_try_push(q, out, data, len) == -1)
+    {
+        atomic_fetch_add(&q->enq_waiters, 1);
+        uint32_t seen = atomic_load(&q->freed);
+        if (queue_try_push(q, out, data, len) == 0)
+        {
+            atomic_fetch_sub(&q->enq_waiters, 1);
+            return;
+        }
+        futex_wait_private(&q->freed, seen);
+        atomic_fetch_sub(&q->enq_waiters, 1);
+    }
+}
+
+static pool_slot_t* queue_claim(pool_queue_t* q, uint32_t* claimed)
+{
+    pool_slot_t* slot;
+    for (;;)
+    {
+        for (int spins = 0; spins <= spin_limit(); ++spins)
+        {
+            if ((slot = queue_try_claim(q, claimed)) != NULL)
+                return slot;
+            cpu_relax();
+        }
+        atomic_fetch_add(&q->deq_waiters, 1);
+        uint32_t seen = atomic_load(&q->ready);
+        if ((slot = queue_try_claim(q, claimed)) != NULL)
+        {
+            atomic_fetch_sub(&q->deq_waiters, 1);
+            return slot;
+        }
+        futex_wait_private(&q->ready, seen);
+        atomic_fetch_sub(&q->deq_waiters, 1);
+    }
+}
+
+// 在 slot 裡直接處理 job，收到結束訊號就離開
+static void* worker_main(void* arg)
+{
+    pool_worker_t* worker = arg;
+    for (;;)
+    {
+        uint32_t pos;
+        pool_slot_t* slot = queue_claim(worker->queue, &pos);
+        int stop = slot->stop;
+        if (!stop)
+            worker->pool->process(&slot->job, worker->pool->arg);
+        queue_release(worker->queue, pos);
+        if (stop)
+            return NULL;
+    }
+}
+
+void pool_start(pool_t* pool, int workers, int ordered, pool_fn process, void* arg)
+{
+    int queues = ordered ? workers : 1;
+    pool->workers = workers;
+    pool->ordered = ordered;
+    pool->process = process;
+    pool->arg = arg;
+    pool->queues = aligned_alloc(CACHE_LINE, queues * sizeof(pool_queue_t));
+    if (pool->queues == NULL)
+    {
+        perror("aligned_alloc failed");
+        exit(1);
+    }
+    memset(pool->queues, 0, queues * sizeof(pool_queue_t));
+
+    for (int i = 0; i < workers; ++i)
+    {
+        pool->threads[i].pool = pool;
+        pool->threads[i].queue = &pool->queues[ordered ? i : 0];
+        if (pthread_create(&pool->threads[i].thread, NULL, worker_main, &pool->threads[i]) != 0)
+        {
+            perror("pthread_create failed");
+            exit(1);
+        }
+    }
+}
+
+/**
+ * 複製一筆紀錄交給 worker，receive loop 不必等它處理完
+ * 紀錄直接複製到 queue 的 slot 裡，slot 的緩衝區重複使用，平常不需要 malloc
+ * ordered 時依 stream 固定分給同一個 worker，同一個 stream 的紀錄依序處理；
+ * 否則放進共用的 queue，哪個 worker 有空就由哪個處理
+ */
+void pool_submit(pool_t* pool, unsigned int stream, FILE* out, const char* data, size_t len)
+{
+    queue_push(&pool->queues[pool->ordered ? stream % pool->workers : 0], out, data, len);
+}
+
+// 每個 worker 收到一個結束訊號就結束，之前放進去的紀錄都會先處理完
+void pool_stop(pool_t* pool)
+{
+    for (int i = 0; i < pool->workers; ++i)
+        queue_push(pool->threads[i].queue, NULL, NULL, 0);
+    for (int i = 0; i < pool->workers; ++i)
+        pthread_join(pool->threads[i].thread, NULL);
+
+    int queues = pool->ordered ? pool->workers : 1;
+    for (int i = 0; i < queues; ++i)
+        for (int j = 0; j < POOL_SLOTS; ++j)
+            free(pool->queues[i].slots[j].job.data);
+    free(pool->queues);
+}
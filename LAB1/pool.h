@@ -0,0 +1,67 @@
+#ifndef POOL_H
+#define POOL_H
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "mbsync.h"
+
+#define POOL_MAX_WORKERS 64     // worker thread 數的上限
+#define POOL_SLOTS 256          // 每個 queue 的 slot 數，必須是 2 的次方
+
+// 交給 worker 的一筆紀錄，內容複製在 slot 自己的緩衝區裡，worker 處理完才把 slot 還回去
+typedef struct
+{
+    FILE* out;          // -o 的輸出檔，沒有時為 NULL
+    size_t len;         // 不含結尾的 '\0'
+    char* data;
+} job_t;
+
+typedef struct
+{
+    _Atomic uint32_t seq;
+    int stop;           // 結束訊號
+    size_t cap;         // data 緩衝區的大小，只會變大，跨 job 重複使用
+    job_t job;
+} pool_slot_t;
+
+// process 內的 bounded lock-free queue (Vyukov)，job 直接放在 slot 裡，不需要每筆 malloc
+// 和 mpmc.c 一樣 seq 存 (sequence - slot index)，全為 0 就是空 queue
+typedef struct
+{
+    _Alignas(CACHE_LINE) _Atomic uint32_t enq;          // 下一個寫入位置
+    _Alignas(CACHE_LINE) _Atomic uint32_t deq;          // 下一個讀取位置
+    _Alignas(CACHE_LINE) _Atomic uint32_t ready;        // 喚醒序號：worker 睡眠的 private futex word
+    _Atomic uint32_t deq_waiters;                       // 在 ready 上睡的 worker 數
+    _Alignas(CACHE_LINE) _Atomic uint32_t freed;        // 喚醒序號：receive loop 等空位的 private futex word
+    _Atomic uint32_t enq_waiters;
+    pool_slot_t slots[POOL_SLOTS];
+} pool_queue_t;
+
+typedef void (*pool_fn)(const job_t* job, void* arg);
+
+typedef struct pool pool_t;
+
+typedef struct
+{
+    pool_t* pool;
+    pool_queue_t* queue;    // 這個 worker 取 job 的 queue
+    pthread_t thread;
+} pool_worker_t;
+
+struct pool
+{
+    int workers;
+    int ordered;            // 1：同一個 stream 固定給同一個 worker，保持順序
+    pool_fn process;        // worker 處理一筆紀錄
+    void* arg;
+    pool_queue_t* queues;   // ordered 時每個 worker 一個，否則所有 worker 共用 queues[0]
+    pool_worker_t threads[POOL_MAX_WORKERS];
+};
+
+void pool_start(pool_t* pool, int workers, int ordered, pool_fn process, void* arg);
+void pool_submit(pool_t* pool, unsigned int stream, FILE* out, const char* data, size_t len);
+void pool_stop(pool_t* pool);
+
+#endif
@@ -0,0 +1,157 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include "readahead.h"
+#include "mbsync.h"
+
+static void block_wait(ra_block_t* block, uint32_t until)
+{
+    uint32_t full;
+    while ((full = atomic_load_explicit(&block->full, memory_order_acquire)) != until)
+        futex_wait(&block->full, full);
+}
+
+static void block_set(ra_block_t* block, uint32_t full)
+{
+    atomic_store_explicit(&block->full, full, memory_order_release);
+    futex_wake(&block->full, 1);
+}
+
+// reader thread：把檔案依序讀進兩塊 block，sender 還沒用完的 block 不會被覆寫
+static void* reader_main(void* arg)
+{
+    readahead_t* ra = arg;
+    for (int i = 0;; i ^= 1)
+    {
+        ra_block_t* block = &ra->blocks[i];
+        block_wait(block, 0);
+
+        size_t len = 0;
+        while (len < RA_BLOCK)
+        {
+            ssize_t n = read(ra->fd, block->data + len, RA_BLOCK - len);
+            if (n == -1 && errno == EINTR)
+                continue;
+            if (n == -1)
+            {
+                perror("read input failed");
+                exit(1);
+            }
+            if (n == 0)
+                break;
+            len += n;
+        }
+        block->len = len;
+        block_set(block, 1);
+        if (len == 0)
+            return NULL;
+    }
+}
+
+/**
+ * 開始在背景讀 fd (一般檔案)，讀檔和傳送重疊進行，磁碟延遲不會擋住 transport
+ */
+readahead_t* ra_open(int fd)
+{
+    readahead_t* ra = calloc(1, sizeof(readahead_t));
+    if (ra == NULL)
+    {
+        perror("calloc failed");
+        exit(1);
+    }
+    ra->fd = fd;
+    for (int i = 0; i < 2; ++i)
+    {
+        ra->blocks[i].data = malloc(RA_BLOCK);
+        if (ra->blocks[i].data == NULL)
+        {
+            perror("malloc failed");
+            exit(1);
+        }
+    }
+    // 告訴 kernel 會從頭到尾讀，read-ahead 開大一點
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    if (pthread_create(&ra->thread, NULL, reader_main, ra) != 0)
+    {
+        perror("pthread_create failed");
+        exit(1);
+    }
+    return ra;
+}
+
+static void carry_append(readahead_t* ra, size_t* len, const char* data, size_t n)
+{
+    if (*len + n > ra->carry_cap)
+    {
+        size_t cap = ra->carry_cap ? ra->carry_cap : 4096;
+        while (cap < *len + n)
+            cap *= 2;
+        ra->carry = realloc(ra->carry, cap);
+        if (ra->carry == NULL)
+        {
+            perror("realloc failed");
+            exit(1);
+        }
+        ra->carry_cap = cap;
+    }
+    memcpy(ra->carry + *len, data, n);
+    *len += n;
+}
+
+/**
+ * 取出下一行 (含 '\n')，回傳長度，檔案結束回傳 -1，和 getline 一樣
+ * 以 memchr (glibc 以 SIMD 實作) 找換行；整行都在同一個 block 時直接指向 block，不複製
+ * *line 沒有 '\0' 結尾，只保證在下一次 ra_next 之前有效
+ */
+ssize_t ra_next(readahead_t* ra, const char** line)
+{
+    size_t carry_len = 0;
+    for (;;)
+    {
+        ra_block_t* block = &ra->blocks[ra->current];
+        block_wait(block, 1);
+        if (block->len == 0)
+        {
+            // 最後一行沒有換行
+            *line = ra->carry;
+            return carry_len > 0 ? (ssize_t)carry_len : -1;
+        }
+
+        const char* start = block->data + ra->pos;
+        size_t avail = block->len - ra->pos;
+        const char* newline = memchr(start, '\n', avail);
+        if (newline != NULL)
+        {
+            size_t n = newline - start + 1;
+            ra->pos += n;
+            if (carry_len == 0)
+            {
+                *line = start;
+                return n;
+            }
+            carry_append(ra, &carry_len, start, n);
+            *line = ra->carry;
+            return carry_len;
+        }
+
+        // 這個 block 用完了，剩下的半行先接起來，把 block 還給 reader thread
+        carry_append(ra, &carry_len, start, avail);
+        block_set(block, 0);
+        ra->current ^= 1;
+        ra->pos = 0;
+    }
+}
+
+// ra_next 回傳 -1 之後才呼叫，此時 reader thread 已經讀到檔案結尾而結束
+void ra_close(readahead_t* ra)
+{
+    pthread_join(ra->thread, NULL);
+    free(ra->blocks[0].data);
+    free(ra->blocks[1].data);
+    free(ra->carry);
+    free(ra);
+}
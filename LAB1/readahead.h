@@ -0,0 +1,34 @@
+#ifndef READAHEAD_H
+#define READAHEAD_H
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sys/types.h>
+
+#define RA_BLOCK (1UL << 20)    // reader thread 每次讀進來的大小
+
+// 兩塊輪流使用的緩衝區：reader thread 填一塊的同時，sender 從另一塊切出一行一行的紀錄
+typedef struct
+{
+    char* data;
+    size_t len;                 // 0 代表檔案結束
+    _Atomic uint32_t full;      // 1：已經填好，等 sender 取用；也是雙方等待的 futex word
+} ra_block_t;
+
+typedef struct
+{
+    int fd;
+    pthread_t thread;
+    ra_block_t blocks[2];
+    int current;                // sender 正在切的 block
+    size_t pos;                 // 下一行在 current 中的位置
+    char* carry;                // 跨越兩個 block 的行接在這裡
+    size_t carry_cap;
+} readahead_t;
+
+readahead_t* ra_open(int fd);
+ssize_t ra_next(readahead_t* ra, const char** line);
+void ra_close(readahead_t* ra);
+
+#endif
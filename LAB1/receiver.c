@@ -2,18 +2,75 @@
 #define CYAN "\033[36m"
 #define RED  "\033[31m"
 #define RESET "\033[0m"
-struct sembuf sb = {0, -1, 0};
+#define USAGE "Usage: %s [-s sysv|futex] [-f csv|json] [-d usec] [-w credits] [-m receivers -i id] [-n senders] [-e channels] [-S bytes] [-H] [-a cpu|auto] [-R] [-o prefix] [-t workers [-O]] [-Q] [-k file] <mechanism>\n"
 void receive(message_t* message_ptr, mailbox_t* mailbox_ptr)
 {
     if(mailbox_ptr->flag == 1)
     {
-        // 從 message queue 接收訊息 
-        msgrcv(mailbox_ptr->storage.msqid, message_ptr, sizeof(*message_ptr), 1, 0);
+        // 目前的 frame 取完了才從 message queue 接收下一個 frame
+        if (batch_empty(mailbox_ptr->batch))
+            batch_recv(mailbox_ptr->batch, mailbox_ptr->storage.msqid);
+        batch_next(mailbox_ptr->batch, &message_ptr->hdr, message_ptr->data, MAX);
     }
     else if(mailbox_ptr->flag == 2)
     {
-        // 從 shared memory 複製訊息內容 
-        strcpy(message_ptr->data, mailbox_ptr->storage.shm_addr);
+        // 從 shared memory 複製訊息標頭與內容 
+        message_t* shm = (message_t*)mailbox_ptr->storage.shm_addr;
+        message_ptr->hdr = shm->hdr;
+        memcpy(message_ptr->data, shm->data, shm->hdr.len);
+    }
+    else if(mailbox_ptr->flag == 3)
+    {
+        // 從 ring buffer 取出一則訊息，ring 是空的才會等待 sender
+        // 服務多個 ring 時改從任一個就緒的 ring 取，全部都空了才在 epoll 上等
+        if (mailbox_ptr->mux != NULL)
+            mux_pop(mailbox_ptr->mux, &message_ptr->hdr, message_ptr->data, MAX);
+        else
+            ring_pop(mailbox_ptr->storage.ring, &message_ptr->hdr, message_ptr->data, MAX);
+    }
+    else if(mailbox_ptr->flag == 4)
+    {
+        // 先取自己的 lane，沒有的話去偷別人的；所有 sender 都送完又取不到就當作 EOF
+        if (mpmc_pop(&mailbox_ptr->mpmc, &message_ptr->hdr, message_ptr->data, MAX) == -1)
+        {
+            strcpy(message_ptr->data, "EOF");
+            message_ptr->hdr.len = strlen(message_ptr->data) + 1;
+        }
+    }
+    else if(mailbox_ptr->flag == 5)
+    {
+        // 依 priority 取出最高的一則，EOF 的 priority 最低所以一定最後到
+        while (mq_receive(mailbox_ptr->storage.fd, (char*)&message_ptr->hdr, MESSAGE_WIRE_MAX, NULL) == -1)
+        {
+            if (errno != EINTR)
+            {
+                perror("mq_receive failed");
+                exit(1);
+            }
+        }
+    }
+    else if(mailbox_ptr->flag == 8)
+    {
+        // 讀目前最新的快照，不會擋住 sender，也不和其他 receiver 互相等待
+        bcast_read(&mailbox_ptr->bcast, &message_ptr->hdr, message_ptr->data, MAX);
+    }
+    else if(mailbox_ptr->flag == 6 || mailbox_ptr->flag == 7)
+    {
+        // 連線 / pipe 被關閉表示 sender 已經不在了，當作 EOF
+        int len;
+        if (mailbox_ptr->flag == 6)
+        {
+            struct iovec iov[2] = {{&message_ptr->hdr, sizeof(msg_hdr_t)}, {message_ptr->data, MAX}};
+            len = readv(mailbox_ptr->storage.fd, iov, 2);
+        }
+        else
+            len = kx_pipe_recv(mailbox_ptr->storage.pipe, &message_ptr->hdr, message_ptr->data, MAX);
+        if (len <= 0)
+        {
+            message_ptr->hdr.len = strlen("EOF") + 1;
+            message_ptr->hdr.flags = 0;
+            strcpy(message_ptr->data, "EOF");
+        }
     }
     /*  TODO: 
         1. Use flag to determine the communication method
@@ -21,22 +78,290 @@ void receive(message_t* message_ptr, mailbox_t* mailbox_ptr)
     */
 }
 
+// mechanism 1 的 frame 是否已經取完 (其他 mechanism 每則訊息都是一個邊界)
+static int at_frame_boundary(mailbox_t* mailbox_ptr)
+{
+    return mailbox_ptr->flag != 1 || batch_empty(mailbox_ptr->batch);
+}
+
+/**
+ * 一筆紀錄的 stream 對應的輸出檔，第一次用到才開檔 (只在 receive loop 呼叫，worker 不會同時開檔)
+ * 檔名是 prefix.<stream>，以 -e 服務多個 channel 時是 prefix.<channel>.<stream>
+ */
+static FILE* open_output(FILE* outputs[], const char* prefix, int channel, int muxed, uint32_t stream)
+{
+    if (stream >= INPUT_MAX_STREAMS)
+    {
+        fprintf(stderr, "Invalid stream %u\n", stream);
+        exit(1);
+    }
+    FILE** out = &outputs[channel * INPUT_MAX_STREAMS + stream];
+    if (*out == NULL)
+    {
+        char path[4096];
+        if (muxed)
+            snprintf(path, sizeof(path), "%s.%d.%u", prefix, channel, stream);
+        else
+            snprintf(path, sizeof(path), "%s.%u", prefix, stream);
+        *out = fopen(path, "w");
+        if (*out == NULL)
+        {
+            perror("fopen failed");
+            exit(1);
+        }
+    }
+    return *out;
+}
+
+// 每一筆紀錄的處理方式，receive loop 和 worker thread 共用
+typedef struct
+{
+    long delay_us;      // 模擬的處理時間
+    int quiet;          // 不逐筆印出
+} handler_t;
+
+// 處理一筆紀錄：印出來、寫到 -o 的輸出檔 (不含結尾的 '\0')，再模擬處理時間
+static void process_record(const handler_t* handler, const char* data, size_t len, FILE* out)
+{
+    if (!handler->quiet)
+        printf(CYAN"Received message:" RESET"%.*s\n", (int)len, data);
+    if (out != NULL)
+        fwrite(data, 1, len, out);
+    if (handler->delay_us > 0)
+        usleep(handler->delay_us);
+}
+
+// worker thread 處理 receive loop 交過來的紀錄
+static void process_job(const job_t* job, void* arg)
+{
+    process_record(arg, job->data, job->len, job->out);
+}
+
+/**
+ * 印出單向延遲的分佈與吞吐量
+ * format 為 "csv" 或 "json" 時，最後再多印一行方便程式解析的結果
+ */
+static void report(const hist_t* latency, uint64_t bytes, double elapsed,
+                   int mechanism, int backend, const char* format)
+{
+    double msg_rate = elapsed > 0 ? latency->total / elapsed : 0.0;
+    double byte_rate = elapsed > 0 ? bytes / elapsed : 0.0;
+    uint64_t p50 = hist_percentile(latency, 50.0);
+    uint64_t p90 = hist_percentile(latency, 90.0);
+    uint64_t p99 = hist_percentile(latency, 99.0);
+    uint64_t p999 = hist_percentile(latency, 99.9);
+
+    printf("Messages: %llu, bytes: %llu, elapsed: %.9f s\n",
+           (unsigned long long)latency->total, (unsigned long long)bytes, elapsed);
+    printf("Throughput: %.1f msg/s, %.1f bytes/s\n", msg_rate, byte_rate);
+    printf("Latency (us): p50 %.3f  p90 %.3f  p99 %.3f  p99.9 %.3f  max %.3f  mean %.3f\n",
+           p50 / 1e3, p90 / 1e3, p99 / 1e3, p999 / 1e3, latency->max / 1e3, hist_mean(latency) / 1e3);
+
+    if (format == NULL)
+        return;
+    if (strcmp(format, "csv") == 0)
+    {
+        printf("mechanism,sync,messages,bytes,elapsed_s,msg_per_s,bytes_per_s,p50_ns,p90_ns,p99_ns,p999_ns,max_ns\n");
+        printf("%d,%s,%llu,%llu,%.9f,%.1f,%.1f,%llu,%llu,%llu,%llu,%llu\n",
+               mechanism, backend == SYNC_SYSV ? "sysv" : "futex",
+               (unsigned long long)latency->total, (unsigned long long)bytes, elapsed, msg_rate, byte_rate,
+               (unsigned long long)p50, (unsigned long long)p90, (unsigned long long)p99,
+               (unsigned long long)p999, (unsigned long long)latency->max);
+    }
+    else if (strcmp(format, "json") == 0)
+    {
+        printf("{\"mechanism\":%d,\"sync\":\"%s\",\"messages\":%llu,\"bytes\":%llu,\"elapsed_s\":%.9f,"
+               "\"msg_per_s\":%.1f,\"bytes_per_s\":%.1f,\"p50_ns\":%llu,\"p90_ns\":%llu,\"p99_ns\":%llu,"
+               "\"p999_ns\":%llu,\"max_ns\":%llu}\n",
+               mechanism, backend == SYNC_SYSV ? "sysv" : "futex",
+               (unsigned long long)latency->total, (unsigned long long)bytes, elapsed, msg_rate, byte_rate,
+               (unsigned long long)p50, (unsigned long long)p90, (unsigned long long)p99,
+               (unsigned long long)p999, (unsigned long long)latency->max);
+    }
+}
+
 int main(int argc, char* argv[])
 {
-    int mechanism = atoi(argv[1]);
+    int backend = SYNC_SYSV;
+    const char* format = NULL;
+    long delay_us = 250000;
+    int window = 1;
+    int receivers = 1, id = 0, senders = 1;
+    int channels = 0;
+    size_t ring_size = 0;
+    int huge = 0;
+    int cpu = AFFINITY_NONE;
+    int rpc = 0;
+    const char* prefix = NULL;
+    int workers = 0, ordered = 0;
+    int quiet = 0;
+    const char* sink_path = NULL;
+    int opt;
+    // 選項：-s sysv|futex，必須和 sender 使用相同的同步機制
+    //       -f csv|json  結束時多印一行機器可讀的統計結果
+    //       -d usec      每則訊息處理完後的等待時間 (預設 250000)
+    //       -w credits   sender 最多可以有幾則 (mechanism 1 為幾個 frame) 還沒被處理 (預設 1)
+    //       -m receivers mechanism 4 的 receiver 總數，-i id 為自己的編號 (0 ~ receivers - 1)
+    //       -n senders   mechanism 4 要等幾個 sender 都送完才結束 (預設 1)
+    //       -e channels  mechanism 3 以 epoll 同時服務 channels 個 ring (sender 以 -c 指定)
+    //       -S bytes     mechanism 3 ring 的大小 (可加 K/M/G)，必須和 sender 相同 (預設 64 個 slot)
+    //       -H           mechanism 3 / 4 的共享記憶體使用 huge page，不能用時退回一般 page
+    //       -a cpu|auto  綁定 CPU；auto 依 cache 拓樸挑一個和 sender 共用 L2 / L3 的 core
+    //       -R           RPC 模式：處理完每一筆紀錄就把內容當作回覆送回 sender (sender 也要加 -R)
+    //       -o prefix    依 sender 的輸入檔 (stream) 分流，各自寫到 prefix.<stream>
+    //                    mechanism 4 有多個 receiver 時每個 receiver 要用不同的 prefix
+    //       -t workers   receive loop 只負責取出訊息，交給 workers 個 thread 處理 (印出、-o、-d)
+    //       -O           配合 -t：同一個 stream 的紀錄固定由同一個 worker 依序處理
+    //       -Q           安靜模式：不逐筆印出收到的內容，每秒印一行進度
+    //       -k file      把收到的內容依序寫進 mmap 的 file (不經過 stdio)，通常配合 -Q 使用
+    while ((opt = getopt(argc, argv, "s:f:d:w:m:i:n:e:S:Ha:Ro:t:OQk:")) != -1)
+    {
+        if (opt == 's' && (backend = mbsync_parse(optarg)) != -1)
+            continue;
+        if (opt == 'f' && (strcmp(optarg, "csv") == 0 || strcmp(optarg, "json") == 0))
+        {
+            format = optarg;
+            continue;
+        }
+        if (opt == 'd' && (delay_us = atol(optarg)) >= 0)
+            continue;
+        if (opt == 'w' && (window = atoi(optarg)) >= 1)
+            continue;
+        if (opt == 'm' && (receivers = atoi(optarg)) >= 1 && receivers <= MPMC_MAX_LANES)
+            continue;
+        if (opt == 'i' && (id = atoi(optarg)) >= 0)
+            continue;
+        if (opt == 'n' && (senders = atoi(optarg)) >= 1)
+            continue;
+        if (opt == 'e' && (channels = atoi(optarg)) >= 1 && channels <= MUX_MAX_CHANNELS)
+            continue;
+        if (opt == 'S' && (ring_size = shm_parse_size(optarg)) > 0)
+            continue;
+        if (opt == 'a' && (cpu = affinity_parse(optarg)) != AFFINITY_NONE)
+            continue;
+        if (opt == 'o')
+        {
+            prefix = optarg;
+            continue;
+        }
+        if (opt == 't' && (workers = atoi(optarg)) >= 1 && workers <= POOL_MAX_WORKERS)
+            continue;
+        if (opt == 'Q')
+        {
+            quiet = 1;
+            continue;
+        }
+        if (opt == 'k')
+        {
+            sink_path = optarg;
+            continue;
+        }
+        if (opt == 'O')
+        {
+            ordered = 1;
+            continue;
+        }
+        if (opt == 'R')
+        {
+            rpc = 1;
+            continue;
+        }
+        if (opt == 'H')
+        {
+            huge = 1;
+            continue;
+        }
+        fprintf(stderr, USAGE, argv[0]);
+        exit(1);
+    }
+    if (optind >= argc || id >= receivers)
+    {
+        fprintf(stderr, USAGE, argv[0]);
+        exit(1);
+    }
+
+    cpu = affinity_apply(cpu, ROLE_RECEIVER);
+    int mechanism = atoi(argv[optind]);
+    // 回覆 ring 只有一個 producer，不能讓多個 worker 同時回覆
+    if ((channels > 0 && mechanism != 3) || (rpc && (mechanism == 4 || mechanism == 8 || channels > 0 || workers > 0))
+        || (ordered && workers == 0))
+    {
+        fprintf(stderr, USAGE, argv[0]);
+        exit(1);
+    }
+    // 在共享的統計頁上登記，mailstat 隨時可以看到這個行程的計數
+    stats_attach(mailbox_key(71), ROLE_RECEIVER, mechanism);
     mailbox_t mailbox;
     mailbox.flag = mechanism;
-    key_t key = ftok("progfile", 65);
+    mailbox.batch = NULL;
+    mailbox.zc.base = NULL;
+    mailbox.zc.size = 0;
+    mailbox.mux = NULL;
+    mailbox.notify_fd = -1;
+    mailbox.reply = rpc ? ring_attach(mailbox_key(69), 0, 0) : NULL;
+    key_t key = mailbox_key(65);
     
     if(mechanism == 1)
     {    
         //int shmid = shmget(key, MAX, 0666 | IPC_CREAT);
         mailbox.storage.msqid = msgget(key, 0666 | IPC_CREAT);
+        mailbox.batch = batch_create(0);
     }
 
     else if(mechanism == 2)
     {
-        mailbox.storage.shm_addr = shmat(shmget(key, MAX, 0666 | IPC_CREAT), NULL, 0);
+        int shmid = shmget(key, sizeof(message_t), 0666 | IPC_CREAT);
+        if (shmid == -1)
+        {
+            perror("shmget failed");
+            exit(1);
+        }
+        mailbox.storage.shm_addr = shmat(shmid, NULL, 0);
+    }
+
+    else if(mechanism == 3)
+    {
+        if (channels == 0)
+        {
+            mailbox.storage.ring = ring_attach(mailbox_key(66), ring_size, huge);
+            printf("Ring buffer: %u slots\n", mailbox.storage.ring->mask + 1);
+        }
+        else
+        {
+            mailbox.mux = mux_open(key);
+            for (int c = 0; c < channels; ++c)
+                mux_add(mailbox.mux, mailbox_key(MUX_PROJ + c), ring_size, huge);
+        }
+    }
+
+    else if(mechanism == 4)
+    {
+        mailbox.mpmc.q = mpmc_attach(mailbox_key(68), huge);
+        mailbox.mpmc.lanes = receivers;
+        mailbox.mpmc.lane = id;
+        mailbox.mpmc.producers = senders;
+    }
+
+    else if(mechanism == 5)
+    {
+        mailbox.storage.fd = kx_mq_open(key, MESSAGE_WIRE_MAX);
+    }
+
+    else if(mechanism == 6)
+    {
+        // 等 sender 連上來才開始
+        mailbox.storage.fd = kx_seq_accept(key);
+    }
+
+    else if(mechanism == 7)
+    {
+        mailbox.storage.pipe = kx_pipe_open(key, 0);
+    }
+
+    else if(mechanism == 8)
+    {
+        // 可以有任意多個 receiver，從附加當下的版本開始讀
+        bcast_attach(&mailbox.bcast, mailbox_key(70), huge, 0);
     }
 
     else
@@ -48,8 +373,44 @@ int main(int argc, char* argv[])
     message_t message;
     struct timespec start, end;
     double time_spent = 0.0;
+    hist_t latency;             // 每則訊息從 sender 送出到 receiver 收到的時間 (ns)
+    uint64_t bytes = 0;
+    uint64_t first_ns = 0, last_ns = 0;
+    // 把超過 MAX 被切段的紀錄接回來，每個 (channel, stream) 各一份：
+    // mechanism 5 以 -q strict 送出時，優先權高的 stream 會插到其他 stream 的分段之間
+    static stream_t streams[MUX_MAX_CHANNELS * INPUT_MAX_STREAMS];
+    record_t record;
+    static FILE* outputs[MUX_MAX_CHANNELS * INPUT_MAX_STREAMS];
+    handler_t handler = {delay_us, quiet};
+    pool_t pool;
+    if (workers > 0)
+        pool_start(&pool, workers, ordered, process_job, &handler);
+    sink_t sink;
+    if (sink_path != NULL)
+        sink_open(&sink, sink_path);
+    progress_t progress;
+    progress_init(&progress, "Received");
+    int open_channels = channels ? channels : 1;
+    hist_init(&latency);
+    for (int i = 0; i < MUX_MAX_CHANNELS * INPUT_MAX_STREAMS; ++i)
+        stream_init(&streams[i]);
      
-    int semid = semget(key, 2, 0666 | IPC_CREAT);
+    // broadcast 的 sender 不等任何人，不需要 credit
+    if (mechanism != 8)
+        mbsync_open(&mailbox.sync, backend, backend == SYNC_SYSV ? key : mailbox_key(67));
+
+    // 由 receiver 發出 credit：SIGNAL1 (待處理的訊息) 歸零，SIGNAL0 設為 window
+    // shared memory 只有一個 slot，不能讓 sender 超前
+    if (mechanism == 2 && window > 1)
+    {
+        printf("Shared memory has a single slot, using 1 credit\n");
+        window = 1;
+    }
+    if (mechanism != 8)
+    {
+        mbsync_set(&mailbox.sync, 1, 0);
+        mbsync_set(&mailbox.sync, 0, window);
+    }
     /* 
     sb.sem_num = 0;
     sb.sem_op = 1;
@@ -63,34 +424,169 @@ int main(int argc, char* argv[])
 
     while(1)
     {
-        // sb.sem_num = 0;
-        // sb.sem_op = 1;
-        // semop(semid, &sb, 1);
-        // sb.sem_num = 1;
-        // sb.sem_op = -1;
-        // semop(semid, &sb, 1);
-        
+        // 等 sender 寫好一則訊息 (SIGNAL1) 才讀取，
+        // 否則第一次讀到的可能是上一次執行殘留在共享記憶體的內容
+        // mechanism 1 一次收一整個 frame，只有在 frame 開頭才需要等
+        if (mechanism < 3 && at_frame_boundary(&mailbox))
+            mbsync_wait(&mailbox.sync, 1);
+
         clock_gettime(CLOCK_MONOTONIC, &start);
         receive(&message, &mailbox);
         clock_gettime(CLOCK_MONOTONIC, &end);
         time_spent += (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
-        if (strcmp(message.data, "EOF") == 0)
+
+        // 單向延遲包含了在 queue / 共享記憶體中等待以及交握的時間
+        last_ns = monotonic_ns();
+        // 不同 channel 的分段會交錯到達，mux_pop 取到訊息的 channel 就是 current
+        int channel = mailbox.mux != NULL ? mailbox.mux->current : 0;
+        if (message.hdr.stream >= INPUT_MAX_STREAMS)
+        {
+            fprintf(stderr, "Invalid stream %u\n", message.hdr.stream);
+            exit(1);
+        }
+        stream_t* stream = &streams[channel * INPUT_MAX_STREAMS + message.hdr.stream];
+        if (message.hdr.flags & MSG_MAP)
         {
-            printf(RED"\nSender exit!\n\n");
-            break;
+            // sender 使用 zero-copy 模式：之後的訊息都是指向這個檔案的 (offset, length)
+            zc_open(&mailbox.zc, message.data);
         }
+        else
+        {
+            // 組到一半的紀錄最後一段也可能剛好是 "EOF"
+            if (!(message.hdr.flags & (MSG_ZC | MSG_PARTIAL)) && stream_idle(stream) &&
+                strcmp(message.data, "EOF") == 0)
+            {
+                // 每個 channel 都有自己的 sender，全部都結束才離開
+                if (--open_channels > 0)
+                {
+                    printf(RED"\nSender on channel %d exit!\n\n"RESET, channel);
+                    continue;
+                }
+                // 等 worker 把已經交出去的紀錄都處理完
+                if (workers > 0)
+                    pool_stop(&pool);
+                printf(RED"\nSender exit!\n\n");
+                break;
+            }
+            if (message.hdr.flags & MSG_ZC)
+            {
+                uint32_t len;
+                record.data = zc_data(&mailbox.zc, &message.hdr, message.data, &len);
+                record.len = len;
+                record.stamp = message.hdr.stamp;
+                if (record.data == NULL)
+                {
+                    fprintf(stderr, "Invalid zero-copy descriptor\n");
+                    exit(1);
+                }
+            }
+            if ((message.hdr.flags & MSG_ZC) || stream_feed(stream, &message.hdr, message.data, &record))
+            {
+                // 延遲以紀錄第一段送出的時間計算
+                if (latency.total == 0)
+                    first_ns = record.stamp;
+                hist_record(&latency, last_ns - record.stamp);
+                bytes += record.len;
+                stats_add(STAT_MESSAGES, 1);
+                stats_add(STAT_BYTES, record.len);
 
-        printf(CYAN"Received message:" RESET"%s\n", message.data);
-        usleep(250000);
+                // 分段是依 (channel, stream) 重組的，最後一段的標頭就是整筆紀錄的 stream
+                FILE* out = prefix != NULL ? open_output(outputs, prefix, channel, mailbox.mux != NULL,
+                                                         message.hdr.stream) : NULL;
+                size_t len = strnlen(record.data, record.len);
+                if (sink_path != NULL)
+                    sink_write(&sink, record.data, len);
+                if (quiet)
+                    progress_tick(&progress, latency.total, bytes);
+                if (workers > 0)
+                    pool_submit(&pool, channel * INPUT_MAX_STREAMS + message.hdr.stream, out, record.data, len);
+                else
+                    process_record(&handler, record.data, len, out);
+
+                // 回覆帶回請求的送出時間，sender 用它算來回時間
+                if (mailbox.reply != NULL)
+                {
+                    msg_hdr_t reply = {record.stamp, record.len < MAX ? record.len : MAX, 0, message.hdr.stream};
+                    ring_push(mailbox.reply, &reply, record.data);
+                }
+            }
+        }
 
-        sb.sem_num = 0;
-        sb.sem_op = 1;
-        semop(semid, &sb, 1);
-        sb.sem_num = 1;
-        sb.sem_op = -1;
-        semop(semid, &sb, 1);
+        // 歸還 credit，通知 sender 可以再送一則 (SIGNAL0)
+        if (mechanism < 3 && at_frame_boundary(&mailbox))
+            mbsync_post(&mailbox.sync, 0);
     }
     printf(RESET"Total time taken in receiving msg: %.9f s\n", time_spent);
+    char placement[1024];
+    affinity_describe(cpu, placement, sizeof(placement));
+    printf("Placement: %s\n", placement);
+    if (mechanism == 8)
+        printf("Broadcast: %llu snapshots read, %llu updates skipped, %llu torn reads retried\n",
+               (unsigned long long)mailbox.bcast.reads, (unsigned long long)mailbox.bcast.missed,
+               (unsigned long long)mailbox.bcast.retries);
+    // 吞吐量以第一則訊息送出到 EOF 被收到的時間計算
+    report(&latency, bytes, latency.total ? (last_ns - first_ns) / 1e9 : 0.0, mechanism, backend, format);
+    if (mechanism == 1)
+    {
+        batch_free(mailbox.batch);
+    }
+    else if (mechanism == 3)
+    {
+        // receiver 最後離開，順便刪掉 ring，下次執行才會從空的 ring 開始
+        if (mailbox.mux != NULL)
+            mux_close(mailbox.mux);
+        else
+        {
+            ring_detach(mailbox.storage.ring);
+            ring_destroy(mailbox_key(66));
+        }
+    }
+    else if (mechanism == 4)
+    {
+        // 最後一個離開的 receiver 負責刪除 queue
+        int last = mpmc_leave(&mailbox.mpmc);
+        mpmc_detach(mailbox.mpmc.q);
+        if (last)
+            mpmc_destroy(mailbox_key(68));
+    }
+    else if (mechanism == 5)
+    {
+        mq_close(mailbox.storage.fd);
+        kx_mq_unlink(key);
+    }
+    else if (mechanism == 6)
+    {
+        close(mailbox.storage.fd);
+    }
+    else if (mechanism == 7)
+    {
+        kx_pipe_close(mailbox.storage.pipe, key, 1);
+    }
+    else if (mechanism == 8)
+    {
+        // sender 已經結束而且沒有別人附加時順便刪除 segment
+        bcast_leave(&mailbox.bcast, mailbox_key(70));
+    }
+    if (mailbox.reply != NULL)
+    {
+        ring_detach(mailbox.reply);
+        ring_destroy(mailbox_key(69));
+    }
+    zc_close(&mailbox.zc);
+    for (int i = 0; i < MUX_MAX_CHANNELS * INPUT_MAX_STREAMS; ++i)
+        stream_free(&streams[i]);
+    if (sink_path != NULL)
+        sink_close(&sink);
+    for (int i = 0; i < MUX_MAX_CHANNELS * INPUT_MAX_STREAMS; ++i)
+        if (outputs[i] != NULL)
+            fclose(outputs[i]);
+    // 收回剩下的 credit，下一個先啟動的 sender 才不會在 receiver 就緒前送出
+    if (mechanism != 8)
+    {
+        mbsync_set(&mailbox.sync, 0, 0);
+        mbsync_close(&mailbox.sync, 1);
+    }
+    stats_detach();
     return 0;
 
     /*  TODO: 
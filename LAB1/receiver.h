@@ -12,34 +12,15 @@
 #include <semaphore.h>
 #include <sys/sem.h>
 #include <time.h>
+#include <errno.h>
+#include <mqueue.h>
+#include <sys/uio.h>
 #include <unistd.h>
-#define MAX 1025
-typedef struct 
-{
-    int flag;      // 1 for message passing, 2 for shared memory
-    union
-    {
-        int msqid; //for system V api. You can replace it with struecture for POSIX api
-        char* shm_addr;
-    }storage;
-} mailbox_t;
-
-
-typedef struct 
-{
-    long mtype;       // 訊息類型 
-    char data[MAX];  // 訊息內容
-    /*  TODO: 
-        Message structure for wrapper
-    */
-} message_t;
-
-union semun 
-{
-    int val;                // Value for SETVAL
-    struct semid_ds *buf;   // Buffer for IPC_STAT, IPC_SET
-    unsigned short *array;  // Array for GETALL, SETALL
-    struct seminfo *__buf;  // Buffer for IPC_INFO (Linux-specific)
-};
+#include "mailbox.h"
+#include "hist.h"
+#include "stream.h"
+#include "input.h"
+#include "pool.h"
+#include "sink.h"
 
 void receive(message_t* message_ptr, mailbox_t* mailbox_ptr);
\ No newline at end of file
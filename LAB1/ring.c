@@ -0,0 +1,172 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include "ring.h"
+#include "shmseg.h"
+
+/**
+ * 等待對方推進 *index (不再等於 seen)
+ * 先 busy spin，對方很快就推進的話不需要 system call；
+ * 之後登記到 waiters 並以 index 本身為 futex word 睡眠
+ */
+static void wait_index(_Atomic uint32_t* index, _Atomic uint32_t* waiters, uint32_t seen)
+{
+    for (int spins = 0; spins < spin_limit(); ++spins)
+    {
+        if (atomic_load_explicit(index, memory_order_acquire) != seen)
+            return;
+        cpu_relax();
+    }
+
+    atomic_fetch_add(waiters, 1);
+    while (atomic_load(index) == seen)
+    {
+        if (futex_wait(index, seen) == -1 && errno != EAGAIN && errno != EINTR)
+        {
+            perror("futex wait failed");
+            break;
+        }
+    }
+    atomic_fetch_sub(waiters, 1);
+}
+
+// 推進 index 之後，只有對方真的在睡時才呼叫 FUTEX_WAKE
+static void wake_index(_Atomic uint32_t* index, _Atomic uint32_t* waiters)
+{
+    if (atomic_load(waiters) > 0)
+        futex_wake(index, 1);
+}
+
+/**
+ * 取得 (必要時建立) ring 所在的共享記憶體並附加到當前行程
+ * 新建立的 segment 內容全為 0，也就是 head == tail 的空 ring，
+ * 所以不論 sender 或 receiver 誰先啟動都不需要另外初始化
+ * size 為整個 segment 的大小 (0 代表 RING_SLOTS 個 slot)，huge 為 1 時使用 huge page
+ */
+ring_t* ring_attach(key_t key, size_t size, int huge)
+{
+    if (size == 0)
+        size = sizeof(ring_t) + RING_SLOTS * sizeof(ring_slot_t);
+    if (size < sizeof(ring_t) + 2 * sizeof(ring_slot_t))
+        size = sizeof(ring_t) + 2 * sizeof(ring_slot_t);
+
+    size_t actual;
+    ring_t* ring = shm_attach(key, size, huge, &actual);
+
+    // 容量以實際的 segment 大小計算 (huge page 會進位)，取不超過的 2 的次方
+    size_t slots = (actual - sizeof(ring_t)) / sizeof(ring_slot_t);
+    if (slots > (1UL << 30))
+        slots = 1UL << 30;
+    uint32_t capacity = 1;
+    while (capacity * 2 <= slots)
+        capacity *= 2;
+    ring->mask = capacity - 1;
+    return ring;
+}
+
+void ring_detach(ring_t* ring)
+{
+    shmdt(ring);
+}
+
+// 標記刪除共享記憶體，讓下一次執行拿到全新 (空) 的 ring
+void ring_destroy(key_t key)
+{
+    int shmid = shmget(key, 0, 0666);
+    if (shmid != -1)
+        shmctl(shmid, IPC_RMID, NULL);
+}
+
+// 成功放入回傳 0，ring 滿了回傳 -1
+int ring_try_push(ring_t* ring, const msg_hdr_t* hdr, const char* data)
+{
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if ((uint32_t)(head - tail) > ring->mask)
+        return -1;
+
+    size_t len = hdr->len < RING_SLOT_SIZE ? hdr->len : RING_SLOT_SIZE;
+    ring_slot_t* slot = &ring->slots[head & ring->mask];
+    memcpy(slot->data, data, len);
+    slot->hdr = *hdr;
+    slot->hdr.len = len;
+
+    // seq_cst：slot 內容在 head 前進之前對 receiver 可見，
+    // 且 head 的寫入必須排在讀取 head_waiters 之前，否則可能漏掉喚醒
+    atomic_store_explicit(&ring->head, head + 1, memory_order_seq_cst);
+    wake_index(&ring->head, &ring->head_waiters);
+    return 0;
+}
+
+// 成功取出回傳訊息長度，ring 是空的回傳 -1
+int ring_try_pop(ring_t* ring, msg_hdr_t* hdr, char* data, size_t cap)
+{
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    if (head == tail)
+        return -1;
+
+    ring_slot_t* slot = &ring->slots[tail & ring->mask];
+    size_t len = slot->hdr.len < cap ? slot->hdr.len : cap;
+    memcpy(data, slot->data, len);
+    *hdr = slot->hdr;
+    hdr->len = len;
+
+    // seq_cst：讀完 slot 之後才把位置還給 sender，理由同上
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_seq_cst);
+    wake_index(&ring->tail, &ring->tail_waiters);
+    return (int)len;
+}
+
+void ring_push(ring_t* ring, const msg_hdr_t* hdr, const char* data)
+{
+    // ring 滿了：等 receiver 把 tail 往前推
+    // seen 要在嘗試之前讀，否則兩者之間的推進會被當成「還沒推進」
+    for (;;)
+    {
+        uint32_t seen = atomic_load(&ring->tail);
+        if (ring_try_push(ring, hdr, data) == 0)
+            return;
+        stats_add(STAT_FULL, 1);
+        wait_index(&ring->tail, &ring->tail_waiters, seen);
+    }
+}
+
+size_t ring_pop(ring_t* ring, msg_hdr_t* hdr, char* data, size_t cap)
+{
+    // ring 是空的：等 sender 把 head 往前推
+    for (;;)
+    {
+        uint32_t seen = atomic_load(&ring->head);
+        int len = ring_try_pop(ring, hdr, data, cap);
+        if (len != -1)
+            return len;
+        stats_add(STAT_EMPTY, 1);
+        wait_index(&ring->head, &ring->head_waiters, seen);
+    }
+}
+
+/**
+ * receiver：準備在 epoll 上睡之前登記，之後 sender 放入資料就會通知
+ * 登記之後再檢查一次 ring，回傳 0 代表期間已經有新資料，不應該睡
+ */
+int ring_arm(ring_t* ring)
+{
+    atomic_store(&ring->armed, 1);
+    if (atomic_load(&ring->head) != atomic_load_explicit(&ring->tail, memory_order_relaxed))
+    {
+        atomic_store(&ring->armed, 0);
+        return 0;
+    }
+    return 1;
+}
+
+// sender：放入資料之後呼叫，回傳 1 代表 receiver 有登記，由呼叫端負責通知 (只通知一次)
+int ring_disarm(ring_t* ring)
+{
+    return atomic_load(&ring->armed) && atomic_exchange(&ring->armed, 0);
+}
\ No newline at end of file
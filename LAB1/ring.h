@@ -0,0 +1,45 @@
+#ifndef RING_H
+#define RING_H
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <sys/types.h>
+#include "mbsync.h"
+#include "msghdr.h"
+
+#define RING_SLOTS 64           // 預設的 slot 數，實際數量由 segment 大小決定 (2 的次方，index 才能直接用 & 取餘數)
+#define RING_SLOT_SIZE MAX      // 每個 slot 可放的最大訊息長度，直接沿用 msghdr.h 的 MAX
+
+typedef struct
+{
+    msg_hdr_t hdr;
+    char data[RING_SLOT_SIZE];
+} ring_slot_t;
+
+// 放在共享記憶體中的 single-producer / single-consumer ring buffer
+// head 只有 sender 寫、tail 只有 receiver 寫，
+// 各自獨佔一條 cache line，避免兩個行程互相 false sharing
+// head / tail 是 32 位元，可以直接當 futex word 讓對方睡在上面
+typedef struct
+{
+    _Alignas(CACHE_LINE) _Atomic uint32_t head;   // 下一個要寫入的位置 (producer)
+    _Alignas(CACHE_LINE) _Atomic uint32_t tail;   // 下一個要讀取的位置 (consumer)
+    _Alignas(CACHE_LINE) _Atomic uint32_t head_waiters;   // 睡在 head 上等資料的 receiver 數
+    _Atomic uint32_t tail_waiters;                        // 睡在 tail 上等空位的 sender 數
+    _Atomic uint32_t armed;                               // receiver 改用 epoll 等待，有新資料要寫它的 eventfd
+    _Alignas(CACHE_LINE) uint32_t mask;   // slot 數 - 1，由 segment 大小算出，每個行程算出來都一樣
+    _Alignas(CACHE_LINE) ring_slot_t slots[];
+} ring_t;
+
+ring_t* ring_attach(key_t key, size_t size, int huge);
+void ring_detach(ring_t* ring);
+void ring_destroy(key_t key);
+
+int ring_try_push(ring_t* ring, const msg_hdr_t* hdr, const char* data);
+int ring_try_pop(ring_t* ring, msg_hdr_t* hdr, char* data, size_t cap);
+void ring_push(ring_t* ring, const msg_hdr_t* hdr, const char* data);
+size_t ring_pop(ring_t* ring, msg_hdr_t* hdr, char* data, size_t cap);
+int ring_arm(ring_t* ring);
+int ring_disarm(ring_t* ring);
+
+#endif
\ No newline at end of file
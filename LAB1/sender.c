@@ -2,19 +2,120 @@
 #define CYAN "\033[36m"
 #define RED  "\033[31m"
 #define RESET "\033[0m"
-struct sembuf sb = {0, -1, 0}; // 用來存 信號量的編號、操作、標誌 
+#define WFQ_QUANTUM 64   // 權重 1 的 stream 每一輪可以送的 bytes
+#define USAGE "Usage: %s [-s sysv|futex] [-b usec] [-r msg/s[:burst]] [-m receivers] [-c channel] [-p priority] [-S bytes] [-H] [-a cpu|auto] [-R depth] [-q strict|wfq[:w0,w1,...]] [-Q] [-z] <mechanism> <input file> [input file...]\n"
 
+// 送出目前打包好的 frame，並通知 receiver (SIGNAL1)
+static void publish_frame(mailbox_t* mailbox_ptr)
+{
+    if (batch_empty_frame(mailbox_ptr->batch))
+        return;
+    batch_flush(mailbox_ptr->batch, mailbox_ptr->storage.msqid);
+    mbsync_post(&mailbox_ptr->sync, 1);
+}
+
+// 開始一個新的 frame 之前要先向 receiver 拿一個 credit (SIGNAL0)
+static void open_frame(mailbox_t* mailbox_ptr)
+{
+    if (batch_empty_frame(mailbox_ptr->batch))
+        mbsync_wait(&mailbox_ptr->sync, 0);
+}
+
+/**
+ * 訊息的送出時間在拿到 credit 之後才標記，
+ * receiver 量到的延遲才不會包含 sender 被 credit 擋住的時間
+ */
 void send(message_t message, mailbox_t* mailbox_ptr)
 {
     if(mailbox_ptr->flag == 1)
     {
-        // 發送訊息的函式 (queue ID, 訊息, 大小, 操作標誌) 
-        msgsnd(mailbox_ptr->storage.msqid, &message, sizeof(message.data), 0);
+        // frame 放不下就先送出目前的 frame (queue ID, 訊息, 大小, 操作標誌)
+        batch_t* batch = mailbox_ptr->batch;
+        open_frame(mailbox_ptr);
+        message.hdr.stamp = monotonic_ns();
+        if (batch_append(batch, &message.hdr, message.data) == -1)
+        {
+            publish_frame(mailbox_ptr);
+            open_frame(mailbox_ptr);
+            message.hdr.stamp = monotonic_ns();
+            batch_append(batch, &message.hdr, message.data);
+        }
+        // EOF 是最後一則訊息，不能留在 frame 裡
+        if (batch_due(batch) || strcmp(message.data, "EOF") == 0)
+            publish_frame(mailbox_ptr);
     }
     else if(mailbox_ptr->flag == 2)
     {
-        // 將訊息複製到共享記憶體 
-        strcpy(mailbox_ptr->storage.shm_addr, message.data);
+        // 單一 slot 一次只能有一則訊息，所以 receiver 只會給一個 credit
+        mbsync_wait(&mailbox_ptr->sync, 0);
+        message.hdr.stamp = monotonic_ns();
+
+        // 將訊息標頭與內容複製到共享記憶體 
+        message_t* shm = (message_t*)mailbox_ptr->storage.shm_addr;
+        shm->hdr = message.hdr;
+        memcpy(shm->data, message.data, message.hdr.len);
+
+        // 啟用 receiver(V操作)，SIGNAL1 加 1
+        mbsync_post(&mailbox_ptr->sync, 1);
+    }
+    else if(mailbox_ptr->flag == 3)
+    {
+        // 放進 ring buffer，ring 滿了才會等待 receiver
+        message.hdr.stamp = monotonic_ns();
+        ring_push(mailbox_ptr->storage.ring, &message.hdr, message.data);
+        if (mailbox_ptr->notify_fd != -1)
+            mux_notify(mailbox_ptr->storage.ring, mailbox_ptr->notify_fd);
+    }
+    else if(mailbox_ptr->flag == 4)
+    {
+        // EOF 不放進 queue：只有一個 receiver 會取到它，
+        // 改成把「已送完的 sender 數」加 1，所有 receiver 都看得到
+        if (strcmp(message.data, "EOF") == 0)
+        {
+            mpmc_finish(&mailbox_ptr->mpmc);
+            return;
+        }
+        message.hdr.stamp = monotonic_ns();
+        mpmc_push(&mailbox_ptr->mpmc, &message.hdr, message.data);
+    }
+    else if(mailbox_ptr->flag == 5)
+    {
+        // mtype 當作 priority；EOF 用最低的 0，才不會超過還在 queue 裡的訊息
+        unsigned int priority = message.mtype;
+        if (message.hdr.flags == 0 && strcmp(message.data, "EOF") == 0)
+            priority = 0;
+        message.hdr.stamp = monotonic_ns();
+        while (mq_send(mailbox_ptr->storage.fd, (const char*)&message.hdr,
+                       sizeof(msg_hdr_t) + message.hdr.len, priority) == -1)
+        {
+            if (errno != EINTR)
+            {
+                perror("mq_send failed");
+                exit(1);
+            }
+        }
+    }
+    else if(mailbox_ptr->flag == 6)
+    {
+        // SOCK_SEQPACKET 保留訊息邊界，一次 write 就是一則訊息
+        struct iovec iov[2] = {{&message.hdr, sizeof(msg_hdr_t)}, {message.data, message.hdr.len}};
+        message.hdr.stamp = monotonic_ns();
+        if (writev(mailbox_ptr->storage.fd, iov, 2) == -1)
+        {
+            perror("write socket failed");
+            exit(1);
+        }
+    }
+    else if(mailbox_ptr->flag == 7)
+    {
+        message.hdr.stamp = monotonic_ns();
+        kx_pipe_send(mailbox_ptr->storage.pipe, &message.hdr, message.data);
+    }
+    else if(mailbox_ptr->flag == 8)
+    {
+        // 直接覆寫最新的值，不管 receiver 讀了沒有
+        message.hdr.stamp = monotonic_ns();
+        bcast_publish(&mailbox_ptr->bcast, &message.hdr, message.data);
     }
     /*  TODO: 
         1. Use flag to determine the communication method
@@ -22,16 +123,230 @@ void send(message_t message, mailbox_t* mailbox_ptr)
     */
 }
 
+// zero-copy：在 mapping 中找下一行，訊息只帶 (offset, length)，回傳這一行的長度
+static uint32_t next_line(const zc_map_t* map, size_t* pos, message_t* message)
+{
+    if (*pos >= map->size)
+        return 0;
+
+    const char* start = map->base + *pos;
+    const char* newline = memchr(start, '\n', map->size - *pos);
+    zc_desc_t desc = {*pos, newline ? newline - start + 1 : map->size - *pos};
+    // 內容不經過 transport，所以一行多長都不需要切段
+    *pos += desc.len;
+
+    memcpy(message->data, &desc, sizeof(desc));
+    message->hdr.len = sizeof(desc);
+    message->hdr.flags = MSG_ZC;
+    return desc.len;
+}
+
+/**
+ * 一筆紀錄 (含結尾的 '\0') 超過 MAX 時切成多段送出，除了最後一段都標上 MSG_PARTIAL，
+ * receiver 再把它們接回來
+ * mechanism 4 有多個 receiver 時各段可能被不同的 receiver 取走，mechanism 8 的前一段
+ * 可能還沒被讀就被覆寫，只能像 fgets 一樣切成各自獨立的訊息
+ */
+static void send_record(message_t* message, mailbox_t* mailbox_ptr, const char* record, size_t len)
+{
+    int independent = (mailbox_ptr->flag == 4 && mailbox_ptr->mpmc.lanes > 1) || mailbox_ptr->flag == 8;
+    size_t off = 0;
+    do
+    {
+        size_t n = len - off;
+        if (independent)
+        {
+            n = n - 1 < MAX - 1 ? n - 1 : MAX - 1;
+            memcpy(message->data, record + off, n);
+            message->data[n] = '\0';
+            message->hdr.len = n + 1;
+            message->hdr.flags = 0;
+            off += n;
+            if (off == len - 1)
+                off = len;
+        }
+        else
+        {
+            // record 不一定有 '\0' 結尾 (可能直接指向 read-ahead 的緩衝區)，最後一段自己補上
+            n = n < MAX ? n : MAX;
+            int last = off + n == len;
+            memcpy(message->data, record + off, n - last);
+            if (last)
+                message->data[n - 1] = '\0';
+            message->hdr.len = n;
+            off += n;
+            message->hdr.flags = off < len ? MSG_PARTIAL : 0;
+        }
+        send(*message, mailbox_ptr);
+    } while (off < len);
+}
+
+/**
+ * RPC 模式：等一個回覆並記錄來回時間 (回覆帶回的是請求送出時的時間)
+ * mechanism 1 要先把打包中的 frame 送出，否則 receiver 根本收不到這些請求
+ */
+static void await_reply(mailbox_t* mailbox_ptr, hist_t* rtt)
+{
+    msg_hdr_t hdr;
+    char data[MAX];
+    if (mailbox_ptr->flag == 1)
+        publish_frame(mailbox_ptr);
+    ring_pop(mailbox_ptr->reply, &hdr, data, MAX);
+    hist_record(rtt, monotonic_ns() - hdr.stamp);
+}
+
+// token bucket：每秒補 rate 個 token，最多累積 burst 個，每送一則訊息花一個
+typedef struct
+{
+    double rate;
+    double burst;
+    double tokens;
+    uint64_t last_ns;
+} bucket_t;
+
+// 解析 "rate" 或 "rate:burst"，burst 預設為 1 (也就是固定間隔送出)
+static int bucket_parse(bucket_t* bucket, const char* arg)
+{
+    char* end;
+    bucket->rate = strtod(arg, &end);
+    bucket->burst = 1;
+    if (*end == ':')
+        bucket->burst = strtod(end + 1, &end);
+    bucket->tokens = bucket->burst;
+    bucket->last_ns = 0;
+    return *end == '\0' && bucket->rate >= 0 && bucket->burst >= 1 ? 0 : -1;
+}
+
+static void bucket_take(bucket_t* bucket)
+{
+    if (bucket->rate <= 0)
+        return;
+
+    uint64_t now = monotonic_ns();
+    if (bucket->last_ns != 0)
+    {
+        bucket->tokens += (now - bucket->last_ns) / 1e9 * bucket->rate;
+        if (bucket->tokens > bucket->burst)
+            bucket->tokens = bucket->burst;
+    }
+    bucket->last_ns = now;
+
+    // token 不夠就睡到剛好補滿一個
+    if (bucket->tokens < 1.0)
+    {
+        uint64_t wait_ns = (uint64_t)((1.0 - bucket->tokens) / bucket->rate * 1e9);
+        struct timespec ts = {wait_ns / 1000000000ULL, wait_ns % 1000000000ULL};
+        nanosleep(&ts, NULL);
+        bucket->last_ns += wait_ns;
+        bucket->tokens = 1.0;
+    }
+    bucket->tokens -= 1.0;
+}
+
 int main(int argc, char* argv[])
 {
-    int mechanism = atoi(argv[1]); // 讀取命令列參數 (1 or 2) 
-    char *input_file = argv[2]; // 讀取命令列參數(檔案名稱)
-    FILE *fp = fopen(input_file, "r");
+    int backend = SYNC_SYSV;
+    long deadline_us = 0;
+    bucket_t bucket = {0};
+    int receivers = 1;
+    int zerocopy = 0;
+    int channel = -1;
+    long priority = 1;
+    size_t ring_size = 0;
+    int huge = 0;
+    int cpu = AFFINITY_NONE;
+    int depth = 0;
+    inputs_t in;
+    inputs_parse_policy(&in, "wfq");
+    int quiet = 0;
+    int opt;
+    // 選項：-s sysv|futex 選擇 sender / receiver 交握用的同步機制
+    //       -b usec      mechanism 1 打包訊息，最多延遲 usec 微秒就送出 (預設 0：不打包)
+    //       -r msg/s[:burst]  以 token bucket 限制送出速率 (預設 0：不限速)
+    //       -m receivers mechanism 4 的 receiver 總數，每個 receiver 一條 lane (預設 1)
+    //       -z           zero-copy：receiver 直接 mmap 輸入檔，訊息只帶 (offset, length)
+    //       -c channel   mechanism 3 送到以 epoll 服務多個 ring 的 receiver (receiver -e) 的第幾個 ring
+    //       -p priority  mechanism 5 的 POSIX message queue priority (1 ~ 32767，預設 1)
+    //       -S bytes     mechanism 3 ring 的大小 (可加 K/M/G)，必須和 receiver 相同 (預設 64 個 slot)
+    //       -H           mechanism 3 / 4 的共享記憶體使用 huge page，不能用時退回一般 page
+    //       -a cpu|auto  綁定 CPU；auto 依 cache 拓樸挑一個和 receiver 共用 L2 / L3 的 core
+    //       -R depth     RPC 模式：receiver (也要加 -R) 回覆每一則訊息，最多 depth 個請求還沒收到回覆
+    //       -q policy    多個輸入檔 (stream) 共用一個 mailbox 時的排程：strict 讓編號小的檔案優先，
+    //                    wfq:w0,w1,... 依權重分配頻寬 (預設 wfq，權重都是 1)
+    //       -Q           安靜模式：不逐筆印出送出的內容，每秒印一行進度
+    while ((opt = getopt(argc, argv, "s:b:r:m:zc:p:S:Ha:R:q:Q")) != -1)
+    {
+        if (opt == 's' && (backend = mbsync_parse(optarg)) != -1)
+            continue;
+        if (opt == 'b' && (deadline_us = atol(optarg)) >= 0)
+            continue;
+        if (opt == 'r' && bucket_parse(&bucket, optarg) == 0)
+            continue;
+        if (opt == 'm' && (receivers = atoi(optarg)) >= 1 && receivers <= MPMC_MAX_LANES)
+            continue;
+        if (opt == 'c' && (channel = atoi(optarg)) >= 0 && channel < MUX_MAX_CHANNELS)
+            continue;
+        if (opt == 'p' && (priority = atol(optarg)) >= 1 && priority < MQ_PRIO_MAX)
+            continue;
+        if (opt == 'S' && (ring_size = shm_parse_size(optarg)) > 0)
+            continue;
+        if (opt == 'a' && (cpu = affinity_parse(optarg)) != AFFINITY_NONE)
+            continue;
+        // 回覆 ring 放得下所有還沒取走的回覆，receiver 才不會被卡住而停止發 credit
+        if (opt == 'R' && (depth = atoi(optarg)) >= 1 && depth <= RING_SLOTS)
+            continue;
+        if (opt == 'q' && inputs_parse_policy(&in, optarg) == 0)
+            continue;
+        if (opt == 'H')
+        {
+            huge = 1;
+            continue;
+        }
+        if (opt == 'Q')
+        {
+            quiet = 1;
+            continue;
+        }
+        if (opt == 'z')
+        {
+            zerocopy = 1;
+            continue;
+        }
+        fprintf(stderr, USAGE, argv[0]);
+        exit(1);
+    }
+    int streams = argc - optind - 1;
+    if (streams < 1 || streams > INPUT_MAX_STREAMS || (zerocopy && streams > 1)
+        || priority + streams - 1 >= MQ_PRIO_MAX)
+    {
+        fprintf(stderr, USAGE, argv[0]);
+        exit(1);
+    }
+
+    cpu = affinity_apply(cpu, ROLE_SENDER);
+    int mechanism = atoi(argv[optind]); // 讀取命令列參數 (1, 2 or 3) 
+    // 回覆 ring 只有一個 producer / consumer，不能和多個 sender / receiver 一起用
+    if ((channel != -1 && mechanism != 3) || (depth > 0 && (mechanism == 4 || mechanism == 8 || channel != -1)))
+    {
+        fprintf(stderr, USAGE, argv[0]);
+        exit(1);
+    }
+    // 每個輸入檔是一個 stream，編號就是它在命令列上的順序
+    // WFQ 每一輪的額度比一則訊息小，各 stream 的紀錄才會細密地交錯，而不是一次送出一大段
+    inputs_open(&in, argv + optind + 1, streams, WFQ_QUANTUM, !zerocopy);
+    // 在共享的統計頁上登記，mailstat 隨時可以看到這個行程的計數
+    stats_attach(mailbox_key(71), ROLE_SENDER, mechanism);
     mailbox_t mailbox;
     mailbox.flag = mechanism;
+    mailbox.batch = NULL;
+    mailbox.zc.base = NULL;
+    mailbox.zc.size = 0;
+    mailbox.mux = NULL;
+    mailbox.notify_fd = -1;
+    mailbox.reply = depth > 0 ? ring_attach(mailbox_key(69), 0, 0) : NULL;
     
     // 生成 key，作為識別的符號 
-    key_t key = ftok("progfile", 65);
+    key_t key = mailbox_key(65);
 
     if(mechanism == 1)
     {    
@@ -39,12 +354,62 @@ int main(int argc, char* argv[])
         
         // 創建一個 message queue，並使用 key來識別  (msggt返回 id)
         mailbox.storage.msqid = msgget(key, 0666 | IPC_CREAT);
+        mailbox.batch = batch_create(deadline_us);
     }
 
     else if(mechanism == 2)
     {
         // 創建共享記憶體(shmget), 並附加到當前進程(shmat) 
-        mailbox.storage.shm_addr = shmat(shmget(key, MAX, 0666 | IPC_CREAT), NULL, 0);
+        int shmid = shmget(key, sizeof(message_t), 0666 | IPC_CREAT);
+        if (shmid == -1)
+        {
+            perror("shmget failed");
+            exit(1);
+        }
+        mailbox.storage.shm_addr = shmat(shmid, NULL, 0);
+    }
+
+    else if(mechanism == 3)
+    {
+        // ring buffer 比單一 slot 大，使用另一個 key 的共享記憶體
+        // 指定 channel 時每個 channel 各有一個 ring，並向 receiver 拿 eventfd
+        if (channel == -1)
+            mailbox.storage.ring = ring_attach(mailbox_key(66), ring_size, huge);
+        else
+        {
+            mailbox.storage.ring = ring_attach(mailbox_key(MUX_PROJ + channel), ring_size, huge);
+            mailbox.notify_fd = mux_connect(key, channel);
+        }
+    }
+
+    else if(mechanism == 4)
+    {
+        // 多個 sender 各自從不同的 lane 開始輪流放，避免全部擠在同一條 lane
+        mailbox.mpmc.q = mpmc_attach(mailbox_key(68), huge);
+        mailbox.mpmc.lanes = receivers;
+        mailbox.mpmc.lane = getpid() % receivers;
+        mailbox.mpmc.producers = 0;
+    }
+
+    else if(mechanism == 5)
+    {
+        mailbox.storage.fd = kx_mq_open(key, MESSAGE_WIRE_MAX);
+    }
+
+    else if(mechanism == 6)
+    {
+        mailbox.storage.fd = kx_seq_connect(key);
+    }
+
+    else if(mechanism == 7)
+    {
+        mailbox.storage.pipe = kx_pipe_open(key, 1);
+    }
+
+    else if(mechanism == 8)
+    {
+        // 不需要 receiver 先啟動，也不需要任何 credit
+        bcast_attach(&mailbox.bcast, mailbox_key(70), huge, 1);
     }
 
     else
@@ -57,23 +422,13 @@ int main(int argc, char* argv[])
     struct timespec start, end;
     double time_spent = 0.0;
     
-    // 取得一組信號量(有兩個)，並將 id存在 semid 
-    int semid = semget(key, 2, 0666 | IPC_CREAT);
-
-    union semun sem_union; // 用來設置信號 
-    sem_union.val = 0;
-    if (semctl(semid, 0, SETVAL, sem_union) == -1) // 初始化信號 0為 0 
-    {
-        perror("semctl failed");
-        exit(1);
-    }
-    
-    sem_union.val = 0;
-    if (semctl(semid, 1, SETVAL, sem_union) == -1) // 初始化信號 1為 0
-    {
-        perror("semctl failed");
-        exit(1);
-    }
+    // 取得一組信號量(有兩個)，初始值 (credit 數) 由 receiver 設定
+    // futex backend 的信號放在另一塊共享記憶體，所以用不同的 key
+    // broadcast 不和 receiver 交握，完全不使用信號量
+    mailbox.sync.wait_ns = 0;
+    mailbox.sync.page = NULL;
+    if (mechanism != 8)
+        mbsync_open(&mailbox.sync, backend, backend == SYNC_SYSV ? key : mailbox_key(67));
 
 
     // sb.sem_num = 0;
@@ -86,45 +441,175 @@ int main(int argc, char* argv[])
 //    semop(semid, &sb, 1);
     
 
-    while (fgets(message.data, MAX, fp) != NULL) 
+    message.hdr.flags = 0;
+    message.hdr.stream = 0;
+    if (zerocopy)
     {
-        // 計時並傳遞訊息
-        message.mtype = 1;
-        clock_gettime(CLOCK_MONOTONIC, &start);
+        // 第一則訊息告訴 receiver 要 mmap 哪個檔案
+        // mechanism 4 的訊息只會被其中一個 receiver 取走，mechanism 8 的會被之後的訊息覆寫，
+        // 沒辦法保證每個 receiver 都收到
+        if (mechanism == 4 || mechanism == 8 || channel != -1 || zc_share(&mailbox.zc, in.streams[0].fp, message.data, MAX) == -1)
+        {
+            fprintf(stderr, "Zero-copy needs a regular input file and cannot be used with mechanism 4, 8 or -c\n");
+            exit(1);
+        }
+        message.mtype = priority;
+        message.hdr.len = strlen(message.data) + 1;
+        message.hdr.flags = MSG_MAP;
         send(message, &mailbox);
-        clock_gettime(CLOCK_MONOTONIC, &end);
-        time_spent += (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
-        printf(CYAN"Sending message:" RESET"%s\n", message.data);
-        
-        // 啟用 receiver(V操作)
-        // 意思是釋放可用資源，所以 SIGNAL1 會加 1 
-        sb.sem_num = 1;
-        sb.sem_op = 1;
-        semop(semid, &sb, 1);
-        
-        // 凍結 sender(P操作) 
-        // 意思是要等待有可用資源，所以要等到 SIGNAL0大於 0才會啟動 
-        // 並且會將 SIGNAL0 減 1 
-        sb.sem_num = 0;
-        sb.sem_op = -1;
-        semop(semid, &sb, 1);
+    }
+    size_t offset = 0;
+    struct pollfd fds[INPUT_MAX_STREAMS];
+
+    hist_t rtt;                 // RPC 模式每個請求的來回時間 (ns)
+    int inflight = 0;
+    hist_init(&rtt);
+    progress_t progress;
+    progress_init(&progress, "Sent");
+
+    uint64_t count = 0, bytes = 0, first_ns = monotonic_ns();
+    uint64_t waited;
+    while (1)
+    {
+        // 計時不包含等待 credit 的時間 (也就是 receiver 還沒處理完的時間)
+        waited = mailbox.sync.wait_ns;
+
+        // frame 裡的訊息已經等了一段時間，而每個 stream 的下一行都還沒準備好，先送出避免延遲超過 deadline
+        if (mechanism == 1 && !zerocopy && batch_wait_input(mailbox.batch, fds, inputs_pollfds(&in, fds)))
+        {
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            publish_frame(&mailbox);
+            clock_gettime(CLOCK_MONOTONIC, &end);
+        }
+        else
+        {
+            size_t len;
+            int idx = 0;
+            if (zerocopy)
+            {
+                if ((len = next_line(&mailbox.zc, &offset, &message)) == 0)
+                    break;
+            }
+            else
+            {
+                // 依 -q 的策略挑一個有資料的 stream，一行再長都能完整讀進來
+                // 一般檔案由 reader thread 在背景一次讀一大塊，這裡只在記憶體中找換行
+                if ((idx = inputs_next(&in, 1)) == -1)
+                    break;
+                len = in.streams[idx].len + 1;
+            }
+
+            bucket_take(&bucket);
+
+            // 計時並傳遞訊息
+            // 整筆紀錄 (含所有分段) 連續送出；但 strict 時 mechanism 5 的 queue 依 stream 排優先順序
+            // (編號小的 priority 高)，高優先權的紀錄會超過低優先權紀錄還在 queue 裡的分段，
+            // 所以 receiver 依 (channel, stream) 分開重組
+            message.mtype = in.policy == SCHED_STRICT ? priority + streams - 1 - idx : priority;
+            message.hdr.stream = idx;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            if (zerocopy)
+                send(message, &mailbox);
+            else
+                send_record(&message, &mailbox, in.streams[idx].line, len);
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            if (!quiet && zerocopy)
+                printf(CYAN"Sending message:" RESET"%.*s\n", (int)len, mailbox.zc.base + offset - len);
+            else if (!quiet)
+                printf(CYAN"Sending message:" RESET"%.*s\n", (int)in.streams[idx].len, in.streams[idx].line);
+            if (!zerocopy)
+                inputs_consume(&in, idx);
+            count++;
+            bytes += len;
+            stats_add(STAT_MESSAGES, 1);
+            stats_add(STAT_BYTES, len);
+            if (quiet)
+                progress_tick(&progress, count, bytes);
+            // pipeline 滿了就先等最早的一個回覆
+            if (depth > 0 && ++inflight == depth)
+            {
+                await_reply(&mailbox, &rtt);
+                inflight--;
+            }
+        }
+        time_spent += (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9
+                      - (mailbox.sync.wait_ns - waited) / 1e9;
+    }
+
+    // 收完所有回覆才送 EOF，receiver 離開時回覆 ring 已經是空的
+    while (inflight > 0)
+    {
+        await_reply(&mailbox, &rtt);
+        inflight--;
     }
 
+    // EOF 之前可能還有一個打包中的 frame，send 會一併送出
     strcpy(message.data, "EOF");
+    message.hdr.len = strlen(message.data) + 1;
+    message.hdr.flags = 0;
+    message.hdr.stream = 0;
     send(message, &mailbox);
-    sb.sem_num = 1;
-    sb.sem_op = 1;
-    semop(semid, &sb, 1);
     
     printf(RED"\nEnd of input file! exit\n\n");
     printf(RESET"Total sending time: %.9f seconds\n", time_spent);
-    fclose(fp);
+    double elapsed = (monotonic_ns() - first_ns) / 1e9;
+    printf("Sent %llu messages (%llu bytes) in %.9f s: %.1f msg/s, %.1f bytes/s\n",
+           (unsigned long long)count, (unsigned long long)bytes, elapsed, count / elapsed, bytes / elapsed);
+    if (depth > 0)
+    {
+        printf("RPC: %llu calls, depth %d, %.1f calls/s\n", (unsigned long long)rtt.total, depth, rtt.total / elapsed);
+        printf("Round trip (us): p50 %.3f  p90 %.3f  p99 %.3f  p99.9 %.3f  max %.3f  mean %.3f\n",
+               hist_percentile(&rtt, 50.0) / 1e3, hist_percentile(&rtt, 90.0) / 1e3,
+               hist_percentile(&rtt, 99.0) / 1e3, hist_percentile(&rtt, 99.9) / 1e3,
+               rtt.max / 1e3, hist_mean(&rtt) / 1e3);
+        ring_detach(mailbox.reply);
+    }
+    char placement[1024];
+    affinity_describe(cpu, placement, sizeof(placement));
+    printf("Placement: %s\n", placement);
+    inputs_close(&in);
 
-    if (mechanism == 2) 
+    if (mechanism == 1)
+    {
+        batch_free(mailbox.batch);
+    }
+    else if (mechanism == 2) 
     {
         // 解除共享記憶體連接
         shmdt(mailbox.storage.shm_addr);
     }
+    else if (mechanism == 3)
+    {
+        ring_detach(mailbox.storage.ring);
+        if (mailbox.notify_fd != -1)
+            close(mailbox.notify_fd);
+    }
+    else if (mechanism == 4)
+    {
+        mpmc_detach(mailbox.mpmc.q);
+    }
+    else if (mechanism == 5)
+    {
+        mq_close(mailbox.storage.fd);
+    }
+    else if (mechanism == 6)
+    {
+        // receiver 讀到 0 (連線關閉) 也會當作 EOF
+        close(mailbox.storage.fd);
+    }
+    else if (mechanism == 7)
+    {
+        kx_pipe_close(mailbox.storage.pipe, key, 0);
+    }
+    else if (mechanism == 8)
+    {
+        // segment 留給 receiver：之後才啟動的 receiver 也讀得到最後的 EOF，由最後離開的 receiver 刪除
+        bcast_close(&mailbox.bcast);
+        bcast_detach(&mailbox.bcast);
+    }
+    zc_close(&mailbox.zc);
+    mbsync_close(&mailbox.sync, 0);
+    stats_detach();
 
     return 0;
 
@@ -134,7 +619,7 @@ int main(int argc, char* argv[])
         2) Measure the total sending time
         3) Get the mechanism and the input file from command line arguments
             ‧ e.g. ./sender 1 input.txt
-                    (1 for Message Passing, 2 for Shared Memory)
+                    (1 for Message Passing, 2 for Shared Memory, 3 for Shared Memory Ring Buffer)
         4) Get the messages to be sent from the input file
         5) Print information on the console according to the output format
         6) If the message form the input file is EOF, send an exit message to the receiver.c
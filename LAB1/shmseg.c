@@ -0,0 +1,72 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <sys/ipc.h>
+#include <sys/mman.h>
+#include <sys/shm.h>
+#include "shmseg.h"
+
+// 解析 "65536"、"64K"、"16M"、"1G" 這類大小，格式錯誤回傳 0
+size_t shm_parse_size(const char* arg)
+{
+    char* end;
+    unsigned long long size = strtoull(arg, &end, 10);
+    switch (*end)
+    {
+    case 'G': case 'g': size <<= 10; /* fall through */
+    case 'M': case 'm': size <<= 10; /* fall through */
+    case 'K': case 'k': size <<= 10; end++; break;
+    }
+    return *end == '\0' ? (size_t)size : 0;
+}
+
+/**
+ * 取得 (必要時建立) 至少 size bytes 的共享記憶體並附加到當前行程
+ * huge 為 1 時先試著用 SHM_HUGETLB 建立 (大小進位到 huge page)，
+ * 系統沒有預留 huge page 或權限不足時退回一般 page
+ * 已經存在的 segment 直接沿用，實際大小寫到 *actual (可為 NULL)
+ */
+void* shm_attach(key_t key, size_t size, int huge, size_t* actual)
+{
+    int shmid = shmget(key, 0, 0666);
+    if (shmid == -1 && huge)
+    {
+        size_t rounded = (size + SHM_HUGE_PAGE - 1) & ~(SHM_HUGE_PAGE - 1);
+        shmid = shmget(key, rounded, 0666 | IPC_CREAT | IPC_EXCL | SHM_HUGETLB);
+        if (shmid == -1 && errno != EEXIST)
+            fprintf(stderr, "Huge pages unavailable for segment %08x, using normal pages\n", (unsigned)key);
+    }
+    if (shmid == -1)
+        shmid = shmget(key, size, 0666 | IPC_CREAT);
+    if (shmid == -1)
+    {
+        perror("shmget failed");
+        exit(1);
+    }
+
+    struct shmid_ds ds;
+    if (shmctl(shmid, IPC_STAT, &ds) == -1)
+    {
+        perror("shmctl failed");
+        exit(1);
+    }
+    // 上一次執行留下的 segment 比較小，要先以 ipcrm 刪除
+    if (ds.shm_segsz < size)
+    {
+        fprintf(stderr, "Segment %08x has %zu bytes, need %zu\n", (unsigned)key, (size_t)ds.shm_segsz, size);
+        exit(1);
+    }
+
+    void* addr = shmat(shmid, NULL, 0);
+    if (addr == (void*)-1)
+    {
+        perror("shmat failed");
+        exit(1);
+    }
+    // 退回一般 page 時至少請 kernel 用 transparent huge page (shmem_enabled 允許的話)
+    if (huge)
+        madvise(addr, ds.shm_segsz, MADV_HUGEPAGE);
+    if (actual != NULL)
+        *actual = ds.shm_segsz;
+    return addr;
+}
@@ -0,0 +1,11 @@
+#ifndef SHMSEG_H
+#define SHMSEG_H
+#include <stddef.h>
+#include <sys/types.h>
+
+#define SHM_HUGE_PAGE (2UL << 20)   // x86-64 預設的 huge page 大小
+
+size_t shm_parse_size(const char* arg);
+void* shm_attach(key_t key, size_t size, int huge, size_t* actual);
+
+#endif
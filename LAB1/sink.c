@@ -0,0 +1,95 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "sink.h"
+#include "msghdr.h"
+
+static void sink_reserve(sink_t* sink, size_t size)
+{
+    if (ftruncate(sink->fd, size) == -1)
+    {
+        perror("ftruncate failed");
+        exit(1);
+    }
+    // 先把 block 配置好，寫入時才不會在 page fault 裡配置；不支援的檔案系統就算了
+    posix_fallocate(sink->fd, sink->size, size - sink->size);
+
+    if (sink->base == NULL)
+        sink->base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, sink->fd, 0);
+    else
+        sink->base = mremap(sink->base, sink->size, size, MREMAP_MAYMOVE);
+    if (sink->base == MAP_FAILED)
+    {
+        perror("mmap sink failed");
+        exit(1);
+    }
+    madvise(sink->base, size, MADV_SEQUENTIAL);
+    sink->size = size;
+}
+
+void sink_open(sink_t* sink, const char* path)
+{
+    sink->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0666);
+    if (sink->fd == -1)
+    {
+        perror("open sink failed");
+        exit(1);
+    }
+    sink->base = NULL;
+    sink->size = 0;
+    sink->len = 0;
+    sink_reserve(sink, SINK_RESERVE);
+}
+
+void sink_write(sink_t* sink, const char* data, size_t len)
+{
+    if (sink->len + len > sink->size)
+    {
+        size_t size = sink->size * 2;
+        while (size < sink->len + len)
+            size *= 2;
+        sink_reserve(sink, size);
+    }
+    memcpy(sink->base + sink->len, data, len);
+    sink->len += len;
+}
+
+// 把檔案截到實際寫入的長度，資料由 kernel 從 page cache 寫回
+void sink_close(sink_t* sink)
+{
+    munmap(sink->base, sink->size);
+    if (ftruncate(sink->fd, sink->len) == -1)
+        perror("ftruncate failed");
+    close(sink->fd);
+}
+
+void progress_init(progress_t* progress, const char* label)
+{
+    progress->label = label;
+    progress->last_ns = monotonic_ns();
+    progress->next_ns = progress->last_ns + PROGRESS_NS;
+    progress->last_count = 0;
+    progress->last_bytes = 0;
+}
+
+// 每則訊息呼叫一次，距離上一行超過 PROGRESS_NS 才印
+void progress_tick(progress_t* progress, uint64_t count, uint64_t bytes)
+{
+    uint64_t now = monotonic_ns();
+    if (now < progress->next_ns)
+        return;
+
+    double interval = (now - progress->last_ns) / 1e9;
+    printf("%s %llu messages, %llu bytes (%.1f msg/s, %.1f bytes/s)\n", progress->label,
+           (unsigned long long)count, (unsigned long long)bytes,
+           (count - progress->last_count) / interval, (bytes - progress->last_bytes) / interval);
+    fflush(stdout);
+    progress->last_ns = now;
+    progress->next_ns = now + PROGRESS_NS;
+    progress->last_count = count;
+    progress->last_bytes = bytes;
+}
@@ -0,0 +1,35 @@
+#ifndef SINK_H
+#define SINK_H
+#include <stddef.h>
+#include <stdint.h>
+
+#define SINK_RESERVE (64UL << 20)   // 輸出檔一開始預先配置的大小，不夠時以兩倍成長
+#define PROGRESS_NS 1000000000ULL   // 安靜模式下每隔多久印一行進度
+
+// 把收到的內容直接 memcpy 進 mmap 的輸出檔，不經過 stdio
+typedef struct
+{
+    int fd;
+    char* base;
+    size_t size;        // 目前 mapping (也就是檔案) 的大小
+    size_t len;         // 已經寫入的 bytes
+} sink_t;
+
+// 安靜模式只定期印出累計的數量與這段時間的速率
+typedef struct
+{
+    const char* label;
+    uint64_t next_ns;
+    uint64_t last_ns;
+    uint64_t last_count;
+    uint64_t last_bytes;
+} progress_t;
+
+void sink_open(sink_t* sink, const char* path);
+void sink_write(sink_t* sink, const char* data, size_t len);
+void sink_close(sink_t* sink);
+
+void progress_init(progress_t* progress, const char* label);
+void progress_tick(progress_t* progress, uint64_t count, uint64_t bytes);
+
+#endif
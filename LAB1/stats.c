@@ -0,0 +1,74 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include "stats.h"
+
+_Thread_local stats_slot_t* stats_self = NULL;
+static stats_page_t* stats_page = NULL;
+
+// create 為 0 時 (mailstat) 統計頁不存在就回傳 NULL
+stats_page_t* stats_map(key_t key, int create)
+{
+    int shmid = shmget(key, sizeof(stats_page_t), 0666 | (create ? IPC_CREAT : 0));
+    if (shmid == -1)
+    {
+        if (create)
+        {
+            perror("shmget stats page failed");
+            exit(1);
+        }
+        return NULL;
+    }
+    stats_page_t* page = shmat(shmid, NULL, 0);
+    if (page == (void*)-1)
+    {
+        perror("shmat stats page failed");
+        exit(1);
+    }
+    return page;
+}
+
+// 行程已經結束 (被 kill 而沒有清掉 slot) 的 slot 可以重新使用
+int stats_alive(pid_t pid)
+{
+    return pid != 0 && (kill(pid, 0) == 0 || errno != ESRCH);
+}
+
+/**
+ * 在統計頁上登記一個 slot，之後主 thread 的計數都記在上面
+ * 沒有空的 slot 時只印出警告，不影響傳輸
+ */
+void stats_attach(key_t key, int role, int mechanism)
+{
+    stats_page = stats_map(key, 1);
+    for (int i = 0; i < STATS_SLOTS; ++i)
+    {
+        stats_slot_t* slot = &stats_page->slots[i];
+        int32_t pid = atomic_load(&slot->pid);
+        if (stats_alive(pid) || !atomic_compare_exchange_strong(&slot->pid, &pid, getpid()))
+            continue;
+
+        slot->role = role;
+        slot->mechanism = mechanism;
+        for (int c = 0; c < STAT_COUNT; ++c)
+            atomic_store(&slot->counters[c], 0);
+        stats_self = slot;
+        return;
+    }
+    fprintf(stderr, "Stats page is full, this process will not be shown in mailstat\n");
+}
+
+void stats_detach(void)
+{
+    if (stats_self != NULL)
+        atomic_store(&stats_self->pid, 0);
+    stats_self = NULL;
+    if (stats_page != NULL)
+        shmdt(stats_page);
+    stats_page = NULL;
+}
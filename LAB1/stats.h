@@ -0,0 +1,53 @@
+#ifndef STATS_H
+#define STATS_H
+#include <stdint.h>
+#include <stdatomic.h>
+#include <sys/types.h>
+
+#define STATS_SLOTS 32          // 同時最多幾個 sender / receiver 登記在統計頁上
+
+// 每個行程維護的計數器
+enum
+{
+    STAT_MESSAGES,      // 送出 / 收到的紀錄數
+    STAT_BYTES,         // 送出 / 收到的 bytes
+    STAT_FULL,          // sender 因為 buffer 滿了 (沒有 credit / 空位) 而必須等待的次數
+    STAT_EMPTY,         // receiver 因為 buffer 是空的而必須等待的次數
+    STAT_SPINS,         // busy spin 的次數 (cpu_relax)
+    STAT_SLEEPS,        // 進入 FUTEX_WAIT 的次數
+    STAT_COUNT
+};
+
+// 一個行程的統計，只有登記的行程 (的主 thread) 會寫，所以不需要 atomic 加法
+typedef struct
+{
+    _Alignas(64) _Atomic int32_t pid;   // 0 代表沒人使用
+    int32_t role;                       // ROLE_SENDER / ROLE_RECEIVER
+    int32_t mechanism;
+    _Atomic uint64_t counters[STAT_COUNT];
+} stats_slot_t;
+
+// 放在共享記憶體中的統計頁，mailstat 隨時可以附加上來讀
+typedef struct
+{
+    stats_slot_t slots[STATS_SLOTS];
+} stats_page_t;
+
+// 目前 thread 登記的 slot；worker thread 等沒有登記的 thread 為 NULL，不計數
+extern _Thread_local stats_slot_t* stats_self;
+
+static inline void stats_add(int counter, uint64_t n)
+{
+    stats_slot_t* slot = stats_self;
+    if (slot != NULL)
+        atomic_store_explicit(&slot->counters[counter],
+                              atomic_load_explicit(&slot->counters[counter], memory_order_relaxed) + n,
+                              memory_order_relaxed);
+}
+
+stats_page_t* stats_map(key_t key, int create);
+void stats_attach(key_t key, int role, int mechanism);
+void stats_detach(void);
+int stats_alive(pid_t pid);
+
+#endif
@@ -0,0 +1,69 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "stream.h"
+
+void stream_init(stream_t* stream)
+{
+    memset(stream, 0, sizeof(*stream));
+}
+
+void stream_free(stream_t* stream)
+{
+    free(stream->buf);
+    stream_init(stream);
+}
+
+// 目前沒有組到一半的紀錄
+int stream_idle(const stream_t* stream)
+{
+    return stream->len == 0;
+}
+
+static void reserve(stream_t* stream, size_t need)
+{
+    if (need <= stream->cap)
+        return;
+
+    size_t cap = stream->cap ? stream->cap : 4096;
+    while (cap < need)
+        cap *= 2;
+    char* buf = realloc(stream->buf, cap);
+    if (buf == NULL)
+    {
+        perror("realloc stream failed");
+        exit(1);
+    }
+    stream->buf = buf;
+    stream->cap = cap;
+}
+
+/**
+ * 餵入一則訊息，組成一筆完整的紀錄時回傳 1 並填好 record
+ * 沒有被切段的紀錄 (最常見的情況) 直接指向 data，不經過緩衝區
+ */
+int stream_feed(stream_t* stream, const msg_hdr_t* hdr, const char* data, record_t* record)
+{
+    if (stream->len == 0 && !(hdr->flags & MSG_PARTIAL))
+    {
+        record->data = data;
+        record->len = hdr->len;
+        record->stamp = hdr->stamp;
+        return 1;
+    }
+
+    if (stream->len == 0)
+        stream->stamp = hdr->stamp;
+    reserve(stream, stream->len + hdr->len);
+    memcpy(stream->buf + stream->len, data, hdr->len);
+    stream->len += hdr->len;
+    if (hdr->flags & MSG_PARTIAL)
+        return 0;
+
+    record->data = stream->buf;
+    record->len = stream->len;
+    record->stamp = stream->stamp;
+    // 緩衝區留給下一筆紀錄重複使用，record 在下一次 feed 前都還有效
+    stream->len = 0;
+    return 1;
+}
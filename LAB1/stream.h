@@ -0,0 +1,29 @@
+#ifndef STREAM_H
+#define STREAM_H
+#include <stddef.h>
+#include <stdint.h>
+#include "msghdr.h"
+
+// 一筆完整的紀錄；data 可能直接指向收到的訊息，只保證在下一次 stream_feed 之前有效
+typedef struct
+{
+    const char* data;
+    size_t len;         // 含結尾的 '\0'
+    uint64_t stamp;     // 第一段送出的時間
+} record_t;
+
+// receiver 重組被切段的紀錄用的緩衝區，空間不夠時以兩倍成長
+typedef struct
+{
+    char* buf;
+    size_t len;
+    size_t cap;
+    uint64_t stamp;
+} stream_t;
+
+void stream_init(stream_t* stream);
+void stream_free(stream_t* stream);
+int stream_idle(const stream_t* stream);
+int stream_feed(stream_t* stream, const msg_hdr_t* hdr, const char* data, record_t* record);
+
+#endif
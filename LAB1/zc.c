@@ -0,0 +1,94 @@
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "zc.h"
+
+static void map_fd(zc_map_t* map, int fd, size_t size)
+{
+    map->size = size;
+    map->base = NULL;
+    if (size == 0)
+        return;
+
+    map->base = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (map->base == MAP_FAILED)
+    {
+        perror("mmap failed");
+        exit(1);
+    }
+    // 兩邊都是從頭到尾依序讀
+    madvise(map->base, size, MADV_SEQUENTIAL);
+}
+
+/**
+ * sender：mmap 輸入檔，並把 receiver 開啟用的絕對路徑寫進 path
+ * 只有一般檔案可以這樣分享，其他 (pipe、terminal) 回傳 -1
+ */
+int zc_share(zc_map_t* map, FILE* fp, char* path, size_t cap)
+{
+    char link[64], resolved[PATH_MAX];
+    struct stat st;
+    int fd = fileno(fp);
+
+    if (fstat(fd, &st) == -1 || !S_ISREG(st.st_mode))
+        return -1;
+
+    // 由開啟中的 fd 反查路徑，使用者給的相對路徑在 receiver 的工作目錄下不一定成立
+    snprintf(link, sizeof(link), "/proc/self/fd/%d", fd);
+    ssize_t n = readlink(link, resolved, sizeof(resolved) - 1);
+    if (n == -1 || (size_t)n >= cap)
+        return -1;
+    resolved[n] = '\0';
+    strcpy(path, resolved);
+
+    map_fd(map, fd, st.st_size);
+    return 0;
+}
+
+// receiver：收到 MSG_MAP 時 mmap sender 分享的檔案
+void zc_open(zc_map_t* map, const char* path)
+{
+    struct stat st;
+    int fd = open(path, O_RDONLY);
+    if (fd == -1 || fstat(fd, &st) == -1)
+    {
+        perror("open zero-copy file failed");
+        exit(1);
+    }
+    zc_close(map);
+    map_fd(map, fd, st.st_size);
+    // mapping 建好之後就不需要 fd 了
+    close(fd);
+}
+
+void zc_close(zc_map_t* map)
+{
+    if (map->base != NULL)
+        munmap(map->base, map->size);
+    map->base = NULL;
+    map->size = 0;
+}
+
+/**
+ * 回傳訊息內容的位置：MSG_ZC 指向 mapping 內部，不複製；其他訊息就是 data 本身
+ * 描述子超出 mapping 範圍 (例如檔案被截短) 時回傳 NULL
+ */
+const char* zc_data(const zc_map_t* map, const msg_hdr_t* hdr, const char* data, uint32_t* len)
+{
+    if (!(hdr->flags & MSG_ZC))
+    {
+        *len = hdr->len;
+        return data;
+    }
+
+    zc_desc_t desc;
+    memcpy(&desc, data, sizeof(desc));
+    if (map->base == NULL || desc.off > map->size || desc.len > map->size - desc.off)
+        return NULL;
+    *len = desc.len;
+    return map->base + desc.off;
+}
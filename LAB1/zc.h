@@ -0,0 +1,26 @@
+#ifndef ZC_H
+#define ZC_H
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "msghdr.h"
+
+// zero-copy 模式下訊息只帶 (offset, length)，內容留在兩邊都 mmap 的輸入檔裡
+typedef struct
+{
+    uint64_t off;
+    uint32_t len;
+} zc_desc_t;
+
+typedef struct
+{
+    char* base;     // NULL 代表還沒有 mapping
+    size_t size;
+} zc_map_t;
+
+int zc_share(zc_map_t* map, FILE* fp, char* path, size_t cap);
+void zc_open(zc_map_t* map, const char* path);
+void zc_close(zc_map_t* map);
+const char* zc_data(const zc_map_t* map, const msg_hdr_t* hdr, const char* data, uint32_t* len);
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+#define ARENA_BLOCK_SIZE 4096
+#define ARENA_ALIGN 16
+
+struct arena_block {
+	struct arena_block *next;
+	size_t size, used;
+	// header 只有 24 bytes，不指定的話 data 只對齊到 8；
+	// malloc 的結果已經對齊 16，data 本身對齊之後每次配置的 used 也都是 ARENA_ALIGN 的倍數
+	_Alignas(ARENA_ALIGN) char data[];
+};
+
+// 每一行指令用的 bump allocator：一行的字串、token、cmd_node 都從這裡配置，
+// 執行完用 arena_reset 一次還回去，block 會留著給下一行用
+struct arena {
+	struct arena_block *head, *tail, *cur;
+};
+
+void *arena_alloc(struct arena *a, size_t n);
+char *arena_strdup(struct arena *a, const char *s, size_t len);
+void arena_reset(struct arena *a);
+void arena_free(struct arena *a);
+
+#endif
@@ -2,6 +2,8 @@
 #define BUILTIN_H
 #include "../include/command.h"
 
+#define BUILTIN_TABLE_SIZE 32	// builtin 雜湊表的大小，要比 builtin 數量大
+
 
 int searchBuiltInCommand(struct cmd_node *cmd);
 int execBuiltInCommand(int status,struct cmd_node *cmd);
@@ -12,6 +14,12 @@ int cd(char **args);
 int echo(char **args);
 int exit_shell(char **args);
 int record(char **args);
+int hash(char **args);
+int jobs(char **args);
+int fg(char **args);
+int bg(char **args);
+int wait_jobs(char **args);
+int parallel(char **args);
 
 extern const char *builtin_str[];
 
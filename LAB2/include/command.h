@@ -2,13 +2,15 @@
 #define COMMAND_H
 
 #define MAX_RECORD_NUM 16
-#define BUF_SIZE 1024
+#define BUF_SIZE 1024		// 每筆 history 保留的長度，輸入的行本身沒有長度限制
+#define ARGS_INIT_SIZE 8	// args 一開始的大小，不夠時加倍
 
 #include <stdbool.h>
+#include "arena.h"
 
 struct cmd_node {
-	char **args;
-	int length;
+	char **args;		// 以 NULL 結尾
+	int length, capacity;
 	char *in_file, *out_file;
 	int in,out;
 	struct cmd_node *next;
@@ -18,13 +20,14 @@ struct cmd_node {
 struct cmd {
 	struct cmd_node *head;
 	int pipe_num;
+	bool background;	// 以 & 結尾，在背景執行
 };
 
 extern char *history[MAX_RECORD_NUM];
 extern int history_count;
 
-char *read_line();
-struct cmd *split_line(char *);
+char *read_line(struct arena *a);
+struct cmd *split_line(struct arena *a, char *);
 void test_cmd_struct(struct cmd *);
 void test_pipe_struct(struct cmd_node *pipe);
 #endif
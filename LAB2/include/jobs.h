@@ -0,0 +1,38 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <stdbool.h>
+#include <spawn.h>
+#include <sys/types.h>
+#include "command.h"
+
+enum proc_state { PROC_RUNNING, PROC_STOPPED, PROC_DONE };
+
+// 一個 pipeline 就是一個 job，所有行程放在同一個 process group (pgid)
+struct job {
+	int id;				// jobs 顯示的編號
+	pid_t pgid;			// 0 代表還沒有行程啟動成功
+	int nprocs;
+	pid_t *pids;
+	enum proc_state *states;
+	int status;			// pipeline 最後一個行程的 wait status
+	char *cmdline;
+	struct job *next;
+};
+
+void jobs_init();
+void jobs_subshell();
+void job_spawnattr(posix_spawnattr_t *attr, pid_t pgid);
+struct job *job_new(struct cmd_node *head);
+void job_add_proc(struct job *job, pid_t pid);
+void job_update(pid_t pid, int status);
+void job_remove(struct job *job);
+struct job *job_find(const char *spec);
+int job_wait(struct job *job, bool foreground);
+void job_wait_all();
+void job_continue(struct job *job);
+void job_reap();
+void job_notify();
+void job_print();
+
+#endif
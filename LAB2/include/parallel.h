@@ -0,0 +1,17 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <stdbool.h>
+#include <sys/types.h>
+
+#define PARALLEL_COPY_SIZE 65536	// -g 時把 job 輸出搬到 stdout 的緩衝區大小
+
+// 一個正在執行的 job
+struct par_slot {
+	pid_t pid;		// 0 代表空位
+	int out;		// -g 時暫存輸出的 memfd，否則是 -1
+};
+
+int parallel_run(char **tmpl, char **inputs, int max_jobs, bool group);
+
+#endif
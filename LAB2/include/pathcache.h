@@ -0,0 +1,25 @@
+#ifndef PATHCACHE_H
+#define PATHCACHE_H
+
+#include <spawn.h>
+#include <sys/types.h>
+
+#define PATH_CACHE_BUCKETS 64
+
+// 一個已經在 PATH 中找到的指令 (像 bash 的 hash)
+struct path_entry {
+	char *name;
+	char *path;
+	int hits;
+	struct path_entry *next;
+};
+
+unsigned int name_hash(const char *s);
+const char *path_lookup(const char *name);
+void path_forget(const char *name);
+void path_clear();
+void path_print();
+pid_t path_spawn(char **args, const posix_spawn_file_actions_t *actions,
+		const posix_spawnattr_t *attr);
+
+#endif
@@ -1,10 +1,13 @@
 #ifndef SHELL_H
 #define SHELL_H
 
+#include <sys/types.h>
 #include "command.h"
 
+pid_t launch_proc(struct cmd_node *p, pid_t pgid);
 int spawn_proc(struct cmd_node *);
 int fork_cmd_node(struct cmd *cmd);
+int fork_builtin(struct cmd *cmd, int builtin);
 //void redirection(struct cmd_code *cmd);
 void redirection(struct cmd_node *cmd);
 void shell();
@@ -0,0 +1,66 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/arena.h"
+
+/**
+ * @brief 從 arena 配置 n bytes (對齊 ARENA_ALIGN)
+ * 目前的 block 不夠時往後找，都不夠才 malloc 新的 block 接在最後面
+ */
+void *arena_alloc(struct arena *a, size_t n)
+{
+	n = (n + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+
+	struct arena_block *b = a->cur;
+	while (b && b->used + n > b->size)
+		b = b->next;
+
+	if (b == NULL) {
+		size_t size = n > ARENA_BLOCK_SIZE ? n : ARENA_BLOCK_SIZE;
+		b = malloc(sizeof(struct arena_block) + size);
+		if (b == NULL) {
+			perror("Unable to allocate arena");
+			exit(1);
+		}
+		b->next = NULL;
+		b->size = size;
+		b->used = 0;
+		if (a->tail)
+			a->tail->next = b;
+		else
+			a->head = b;
+		a->tail = b;
+	}
+
+	a->cur = b;
+	void *p = b->data + b->used;
+	b->used += n;
+	return p;
+}
+
+// 複製 s 的前 len 個字元，結尾補 '\0'
+char *arena_strdup(struct arena *a, const char *s, size_t len)
+{
+	char *p = arena_alloc(a, len + 1);
+	memcpy(p, s, len);
+	p[len] = '\0';
+	return p;
+}
+
+// 一次釋放這一行配置的所有東西，block 本身留著重用
+void arena_reset(struct arena *a)
+{
+	for (struct arena_block *b = a->head; b; b = b->next)
+		b->used = 0;
+	a->cur = a->head;
+}
+
+void arena_free(struct arena *a)
+{
+	while (a->head) {
+		struct arena_block *b = a->head;
+		a->head = b->next;
+		free(b);
+	}
+	a->tail = a->cur = NULL;
+}
@@ -7,10 +7,29 @@
 #include <dirent.h>
 #include <fcntl.h>
 #include "../include/builtin.h"
+#include "../include/pathcache.h"
+#include "../include/jobs.h"
+#include "../include/parallel.h"
+
+// builtin 名稱的雜湊表 (linear probing)，存的是 builtin 編號 + 1，0 代表空位
+static int builtin_table[BUILTIN_TABLE_SIZE];
+static bool builtin_table_ready = false;
+
+static void build_builtin_table()
+{
+	for (int i = 0; i < num_builtins(); ++i) {
+		unsigned int slot = name_hash(builtin_str[i]) % BUILTIN_TABLE_SIZE;
+		while (builtin_table[slot])
+			slot = (slot + 1) % BUILTIN_TABLE_SIZE;
+		builtin_table[slot] = i + 1;
+	}
+	builtin_table_ready = true;
+}
 
 /**
  * @brief 
  * Determine whether cmd is a built-in command
+ * 第一次呼叫時建好雜湊表，之後每個指令只需要算一次雜湊、比對一次字串
  * @param cmd Command structure
  * @return int 
  * If command is built-in command return function number
@@ -18,10 +37,17 @@
  */
 int searchBuiltInCommand(struct cmd_node *cmd)
 {
-	for (int i = 0; i < num_builtins(); ++i){
-		if (strcmp(cmd->args[0], builtin_str[i]) == 0){
+	if (cmd->args[0] == NULL)
+		return -1;
+	if (!builtin_table_ready)
+		build_builtin_table();
+
+	unsigned int slot = name_hash(cmd->args[0]) % BUILTIN_TABLE_SIZE;
+	while (builtin_table[slot]) {
+		int i = builtin_table[slot] - 1;
+		if (strcmp(cmd->args[0], builtin_str[i]) == 0)
 			return i;
-		}
+		slot = (slot + 1) % BUILTIN_TABLE_SIZE;
 	}
 	return -1;
 }
@@ -146,6 +172,125 @@ int record(char **args)
 	return 1;
 }
 
+/**
+ * @brief 顯示或管理外部指令的路徑快取
+ * hash          列出快取的指令與使用次數
+ * hash -r       清空快取
+ * hash name...  先找好這些指令的路徑放進快取
+ */
+int hash(char **args)
+{
+	if (args[1] == NULL) {
+		path_print();
+		return 1;
+	}
+	if (strcmp(args[1], "-r") == 0) {
+		path_clear();
+		return 1;
+	}
+	for (int i = 1; args[i]; ++i) {
+		if (path_lookup(args[i]) == NULL)
+			fprintf(stderr, "hash: %s: not found\n", args[i]);
+	}
+	return 1;
+}
+
+int jobs(char **args)
+{
+	job_reap();
+	job_print();
+	return 1;
+}
+
+// fg [%n]：把 job 拉到前景繼續執行並等它，沒有指定就用最新的 job
+int fg(char **args)
+{
+	struct job *job = job_find(args[1]);
+	if (job == NULL) {
+		fprintf(stderr, "fg: %s: no such job\n", args[1] ? args[1] : "current");
+		return -1;
+	}
+	printf("%s\n", job->cmdline);
+	job_continue(job);
+	return job_wait(job, true);
+}
+
+// bg [%n]：讓被暫停的 job 在背景繼續執行
+int bg(char **args)
+{
+	struct job *job = job_find(args[1]);
+	if (job == NULL) {
+		fprintf(stderr, "bg: %s: no such job\n", args[1] ? args[1] : "current");
+		return -1;
+	}
+	printf("[%d]+ %s &\n", job->id, job->cmdline);
+	job_continue(job);
+	return 1;
+}
+
+// wait [%n...]：等指定的 job 結束，沒有指定就等所有的 job
+int wait_jobs(char **args)
+{
+	if (args[1] == NULL) {
+		job_wait_all();
+		return 1;
+	}
+	for (int i = 1; args[i]; ++i) {
+		struct job *job = job_find(args[i]);
+		if (job == NULL) {
+			fprintf(stderr, "wait: %s: no such job\n", args[i]);
+			return -1;
+		}
+		job_wait(job, false);
+	}
+	return 1;
+}
+
+/**
+ * @brief parallel [-j N] [-g] command [args...] [::: inputs...]
+ * 對每個 input 執行一次 command，同時最多 N 個 (預設是 CPU 數)；
+ * 參數中的 {} 換成 input，沒有 {} 就把 input 接在最後。
+ * 沒有 ::: 時從 stdin 一行讀一個 input；-g 讓每個 job 的輸出在它結束時整段印出
+ */
+int parallel(char **args)
+{
+	int max_jobs = sysconf(_SC_NPROCESSORS_ONLN);
+	bool group = false;
+	int i = 1;
+
+	for (; args[i] && args[i][0] == '-'; ++i) {
+		if (strcmp(args[i], "-g") == 0)
+			group = true;
+		else if (strncmp(args[i], "-j", 2) == 0) {
+			const char *n = args[i][2] ? args[i] + 2 : args[++i];
+			if (n == NULL || (max_jobs = atoi(n)) <= 0) {
+				fprintf(stderr, "parallel: -j needs a positive number\n");
+				return -1;
+			}
+		}
+		else {
+			fprintf(stderr, "parallel: unknown option %s\n", args[i]);
+			return -1;
+		}
+	}
+	if (max_jobs <= 0)
+		max_jobs = 1;
+
+	char **inputs = NULL;
+	for (int k = i; args[k]; ++k) {
+		if (strcmp(args[k], ":::") == 0) {
+			args[k] = NULL;
+			inputs = &args[k + 1];
+			break;
+		}
+	}
+	if (args[i] == NULL) {
+		fprintf(stderr, "usage: parallel [-j N] [-g] command [args...] [::: inputs...]\n");
+		return -1;
+	}
+	return parallel_run(&args[i], inputs, max_jobs, group);
+}
+
 const char *builtin_str[] = {
  	"help",
  	"cd",
@@ -153,6 +298,12 @@ const char *builtin_str[] = {
 	"echo",
  	"exit",
  	"record",
+	"hash",
+	"jobs",
+	"fg",
+	"bg",
+	"wait",
+	"parallel",
 };
 
 const int (*builtin_func[]) (char **) = {
@@ -162,6 +313,12 @@ const int (*builtin_func[]) (char **) = {
 	&echo,
 	&exit_shell,
   	&record,
+	&hash,
+	&jobs,
+	&fg,
+	&bg,
+	&wait_jobs,
+	&parallel,
 };
 
 int num_builtins() {
@@ -1,82 +1,96 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
 #include "../include/command.h"
+#include "../include/arena.h"
 
 /**
  * @brief Read the user's input string
- * 
+ * 行的長度沒有上限：getline 的緩衝區跨行重用，只會變大，
+ * 讀到的內容再複製到這一行的 arena 中
+ * @param a Arena of the current line
  * @return char* 
  * Return string
  */
-char *read_line()
+char *read_line(struct arena *a)
 {
-    char *buffer = (char *)malloc(BUF_SIZE * sizeof(char));
-    if (buffer == NULL) {
-        perror("Unable to allocate buffer");
-        exit(1);
-    }
+	static char *line = NULL;
+	static size_t cap = 0;
 
-	if (fgets(buffer, BUF_SIZE, stdin) != NULL) {
-		if (buffer[0] == '\n' || buffer[0] == ' ' || buffer[0] == '\t') {
-			free(buffer);
-			buffer = NULL;
-		} 
-		else {
-			buffer[strcspn(buffer, "\n")] = 0;
-			strncpy(history[history_count % MAX_RECORD_NUM], buffer, BUF_SIZE);
-			++history_count;
-		}
-	}
+	ssize_t len = getline(&line, &cap, stdin);
+	if (len == -1)
+		return NULL;
+	if (line[0] == '\n' || line[0] == ' ' || line[0] == '\t')
+		return NULL;
+
+	if (line[len - 1] == '\n')
+		line[--len] = '\0';
+	snprintf(history[history_count % MAX_RECORD_NUM], BUF_SIZE, "%s", line);
+	++history_count;
+
+	return arena_strdup(a, line, len);
+}
+
+static struct cmd_node *new_cmd_node(struct arena *a)
+{
+	struct cmd_node *node = arena_alloc(a, sizeof(struct cmd_node));
+	node->capacity = ARGS_INIT_SIZE;
+	node->args = arena_alloc(a, node->capacity * sizeof(char *));
+	node->args[0] = NULL;
+	node->length = 0;
+	node->in_file = NULL;
+	node->out_file = NULL;
+	node->in = 0;   // 預設為標準輸入
+	node->out = 1;  // 預設為標準輸出
+	node->next = NULL;
+	return node;
+}
 
-	return buffer;
+// 加入一個參數，args 滿了就在 arena 中配置兩倍大的陣列，結尾永遠保持 NULL
+static void push_arg(struct arena *a, struct cmd_node *node, char *arg)
+{
+	if (node->length + 1 >= node->capacity) {
+		char **args = arena_alloc(a, node->capacity * 2 * sizeof(char *));
+		memcpy(args, node->args, node->length * sizeof(char *));
+		node->args = args;
+		node->capacity *= 2;
+	}
+	node->args[node->length++] = arg;
+	node->args[node->length] = NULL;
 }
 
 /**
  * @brief Parse the user's command
- * 
+ * cmd、cmd_node 與 args 都配置在 arena 中，執行完由 arena_reset 一次釋放
+ * @param a Arena of the current line
  * @param line User input command
  * @return struct cmd* 
- * Return the parsed cmd structure
+ * Return the parsed cmd structure, or NULL on a syntax error
  */
-struct cmd *split_line(char *line)
+struct cmd *split_line(struct arena *a, char *line)
 {
-	int args_length = 10;
-    struct cmd *new_cmd = (struct cmd *)malloc(sizeof(struct cmd));
-    new_cmd->head = (struct cmd_node *)malloc(sizeof(struct cmd_node));
-    new_cmd->head->args = (char **)malloc(args_length * sizeof(char *));
-	for (int i = 0; i < args_length; ++i)
-		new_cmd->head->args[i] = NULL;
-    new_cmd->head->length = 0;
-    new_cmd->head->next = NULL;
+	struct cmd *new_cmd = arena_alloc(a, sizeof(struct cmd));
+	new_cmd->head = new_cmd_node(a);
 	new_cmd->pipe_num = 0;
+	new_cmd->background = false;
 
 	struct cmd_node *temp = new_cmd->head;
-	temp->in_file 	= NULL;
-	temp->out_file 	= NULL;
-	temp->in       	= 0;
-	temp->out 		= 1;
     char *token = strtok(line, " ");
     while (token != NULL) {
+		// & 只能放在最後面，之後不能再有任何東西
+		if (new_cmd->background) {
+			fprintf(stderr, "syntax error near unexpected token `&'\n");
+			return NULL;
+		}
         if (token[0] == '|') {
-            struct cmd_node *new_pipe = (struct cmd_node *)malloc(sizeof(struct cmd_node));
-			new_pipe->args = (char **)malloc(args_length * sizeof(char *));
-			for (int i = 0; i < args_length; ++i)
-				new_pipe->args[i] = NULL;
-			new_pipe->length = 0;
-			new_pipe->next = NULL;
-			//////// modify here
-			new_pipe->in_file = NULL;
-			new_pipe->out_file = NULL;
-			new_pipe->in = 0;   // 預設為標準輸入
-			new_pipe->out = 1;  // 預設為標準輸出
-			temp->next = new_pipe;
-			temp = new_pipe;
-
-			// modify nere
+			temp->next = new_cmd_node(a);
+			temp = temp->next;
 			// 遇到 '|' 時增加 pipe_num
         	new_cmd->pipe_num++;
+        } else if (token[0] == '&') {
+			new_cmd->background = true;
         } else if (token[0] == '<') {
 			token = strtok(NULL, " ");
             temp->in_file = token;
@@ -84,14 +98,25 @@ struct cmd *split_line(char *line)
 			token = strtok(NULL, " ");
             temp->out_file = token;
         } else {
-			temp->args[temp->length] = token;
-			temp->length++;
+			push_arg(a, temp, token);
         }
-        token = strtok(NULL, " ");
-		// new_cmd->pipe_num++;
-
+        if (token != NULL)
+            token = strtok(NULL, " ");
     }
-	// printf("\npipe_num: %d\n", 	new_cmd->pipe_num);
+
+	// pipeline 中不能有空的命令，例如 "| wc" 或 "echo a |"
+	for (temp = new_cmd->head; new_cmd->pipe_num > 0 && temp; temp = temp->next) {
+		if (temp->length == 0) {
+			fprintf(stderr, "syntax error near unexpected token `|'\n");
+			return NULL;
+		}
+	}
+	// 沒有指令：只有 "&" 是語法錯誤，只有重定向的行直接略過
+	if (new_cmd->head->length == 0) {
+		if (new_cmd->background)
+			fprintf(stderr, "syntax error near unexpected token `&'\n");
+		return NULL;
+	}
     return new_cmd;
 }
 /**
@@ -0,0 +1,328 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/signalfd.h>
+#include "../include/jobs.h"
+
+static struct job *job_list = NULL;	// 依 id 由小到大排列
+static int sigchld_fd = -1;			// SIGCHLD 被 block 起來，改由 signalfd 讀取
+static bool interactive = false;	// stdin 是終端機時才做前景 / 背景的終端機交接
+static pid_t shell_pgid;
+
+// 交給子進程時要恢復成預設處理方式的 signal
+static const int job_signals[] = { SIGINT, SIGQUIT, SIGTSTP, SIGTTIN, SIGTTOU, SIGCHLD };
+
+/**
+ * @brief 準備 job control
+ * 把 SIGCHLD 擋下來交給 signalfd，子進程結束不會打斷 shell，
+ * 在每次顯示提示字元前由 job_reap() 一次回收；
+ * 互動模式下 shell 自成一個 process group 並掌握終端機，忽略 Ctrl-C / Ctrl-Z
+ */
+void jobs_init()
+{
+	sigset_t mask;
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGCHLD);
+	sigprocmask(SIG_BLOCK, &mask, NULL);
+	sigchld_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+	if (sigchld_fd == -1)
+		perror("signalfd");
+
+	interactive = isatty(STDIN_FILENO);
+	if (!interactive)
+		return;
+	for (int i = 0; i < sizeof(job_signals) / sizeof(int); ++i)
+		if (job_signals[i] != SIGCHLD)
+			signal(job_signals[i], SIG_IGN);
+	shell_pgid = getpid();
+	if (setpgid(0, shell_pgid) == -1 && getpgrp() != shell_pgid)
+		shell_pgid = getpgrp();
+	tcsetpgrp(STDIN_FILENO, shell_pgid);
+}
+
+/**
+ * @brief 在 fork 出來執行背景 builtin 的子進程裡呼叫
+ * 子進程不是互動的 shell：不碰終端機、signal 恢復預設處理，
+ * 也不繼承 shell 的 job (那些行程不是它的子進程，fg / wait 對它們沒有意義)
+ */
+void jobs_subshell()
+{
+	while (job_list)
+		job_remove(job_list);
+	if (!interactive)
+		return;
+	interactive = false;
+	for (int i = 0; i < sizeof(job_signals) / sizeof(int); ++i)
+		if (job_signals[i] != SIGCHLD)
+			signal(job_signals[i], SIG_DFL);
+}
+
+/**
+ * @brief 設定子進程的 posix_spawn 屬性
+ * @param pgid 要加入的 process group，0 代表以子進程自己的 pid 開新的 group；
+ * -1 代表留在 shell 的 process group (parallel)，Ctrl-C 會送到子進程，
+ * Ctrl-Z 則跟 shell 一樣被忽略，shell 不會卡在等一個被暫停的行程
+ */
+void job_spawnattr(posix_spawnattr_t *attr, pid_t pgid)
+{
+	sigset_t mask, def;
+	sigemptyset(&mask);
+	sigemptyset(&def);
+	for (int i = 0; i < sizeof(job_signals) / sizeof(int); ++i)
+		if (pgid != -1 || job_signals[i] != SIGTSTP)
+			sigaddset(&def, job_signals[i]);
+
+	posix_spawnattr_init(attr);
+	posix_spawnattr_setflags(attr, (pgid != -1 ? POSIX_SPAWN_SETPGROUP : 0) |
+			POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF);
+	if (pgid != -1)
+		posix_spawnattr_setpgroup(attr, pgid);
+	posix_spawnattr_setsigmask(attr, &mask);
+	posix_spawnattr_setsigdefault(attr, &def);
+}
+
+// 把 pipeline 還原成一行字，給 jobs / fg / bg 顯示
+static char *job_cmdline(struct cmd_node *head)
+{
+	size_t len = 1;
+	for (struct cmd_node *p = head; p; p = p->next) {
+		for (int i = 0; i < p->length; ++i)
+			len += strlen(p->args[i]) + 1;
+		len += (p->in_file ? strlen(p->in_file) + 3 : 0) +
+			(p->out_file ? strlen(p->out_file) + 3 : 0) + 3;
+	}
+
+	char *line = malloc(len), *s = line;
+	for (struct cmd_node *p = head; p; p = p->next) {
+		for (int i = 0; i < p->length; ++i)
+			s += sprintf(s, i ? " %s" : "%s", p->args[i]);
+		if (p->in_file)
+			s += sprintf(s, " < %s", p->in_file);
+		if (p->out_file)
+			s += sprintf(s, " > %s", p->out_file);
+		if (p->next)
+			s += sprintf(s, " | ");
+	}
+	*s = '\0';
+	return line;
+}
+
+/**
+ * @brief 為一個 pipeline 建立 job，放在 job 列表的最後面
+ * 行程啟動後再用 job_add_proc() 加進來
+ */
+struct job *job_new(struct cmd_node *head)
+{
+	int n = 0;
+	for (struct cmd_node *p = head; p; p = p->next)
+		++n;
+
+	struct job *job = malloc(sizeof(struct job));
+	job->pgid = 0;
+	job->nprocs = 0;
+	job->pids = malloc(n * sizeof(pid_t));
+	job->states = malloc(n * sizeof(enum proc_state));
+	job->status = 0;
+	job->cmdline = job_cmdline(head);
+	job->next = NULL;
+
+	struct job **tail = &job_list;
+	job->id = 1;
+	while (*tail) {
+		job->id = (*tail)->id + 1;
+		tail = &(*tail)->next;
+	}
+	*tail = job;
+	return job;
+}
+
+// 第一個加入的行程就是整個 job 的 process group leader
+void job_add_proc(struct job *job, pid_t pid)
+{
+	if (job->pgid == 0)
+		job->pgid = pid;
+	job->pids[job->nprocs] = pid;
+	job->states[job->nprocs++] = PROC_RUNNING;
+}
+
+void job_remove(struct job *job)
+{
+	for (struct job **p = &job_list; *p; p = &(*p)->next) {
+		if (*p == job) {
+			*p = job->next;
+			break;
+		}
+	}
+	free(job->pids);
+	free(job->states);
+	free(job->cmdline);
+	free(job);
+}
+
+// 任何一個行程還在跑就是 running；都結束才是 done；其餘是 stopped
+static enum proc_state job_state(struct job *job)
+{
+	enum proc_state state = PROC_DONE;
+	for (int i = 0; i < job->nprocs; ++i) {
+		if (job->states[i] == PROC_RUNNING)
+			return PROC_RUNNING;
+		if (job->states[i] == PROC_STOPPED)
+			state = PROC_STOPPED;
+	}
+	return state;
+}
+
+// 依 waitpid 的結果更新對應行程的狀態，不屬於任何 job 的 pid 直接忽略
+void job_update(pid_t pid, int status)
+{
+	for (struct job *job = job_list; job; job = job->next) {
+		for (int i = 0; i < job->nprocs; ++i) {
+			if (job->pids[i] != pid)
+				continue;
+			if (WIFSTOPPED(status))
+				job->states[i] = PROC_STOPPED;
+			else if (WIFCONTINUED(status))
+				job->states[i] = PROC_RUNNING;
+			else {
+				job->states[i] = PROC_DONE;
+				if (i == job->nprocs - 1)
+					job->status = status;
+			}
+			return;
+		}
+	}
+}
+
+/**
+ * @brief 用 "%n" 或 "n" 找 job，spec 是 NULL 時回傳最新的 job
+ */
+struct job *job_find(const char *spec)
+{
+	struct job *job = job_list;
+	if (spec == NULL) {
+		while (job && job->next)
+			job = job->next;
+		return job;
+	}
+
+	if (spec[0] == '%')
+		++spec;
+	char *end;
+	long id = strtol(spec, &end, 10);
+	if (*spec == '\0' || *end != '\0')
+		return NULL;
+	while (job && job->id != id)
+		job = job->next;
+	return job;
+}
+
+/**
+ * @brief 等 job 結束或被暫停
+ * foreground 時先把終端機交給 job，等完再拿回來；
+ * 補送一次 SIGCONT，避免 job 在拿到終端機之前讀取而被 SIGTTIN 暫停
+ * @return int 
+ * job 結束就從列表移除，依最後一個行程是否正常結束回傳 1 或 -1；被暫停回傳 1
+ */
+int job_wait(struct job *job, bool foreground)
+{
+	if (foreground && interactive) {
+		tcsetpgrp(STDIN_FILENO, job->pgid);
+		kill(-job->pgid, SIGCONT);
+	}
+
+	while (job_state(job) == PROC_RUNNING) {
+		int status;
+		pid_t pid = waitpid(-job->pgid, &status, WUNTRACED);
+		if (pid == -1)
+			break;
+		job_update(pid, status);
+	}
+
+	if (foreground && interactive)
+		tcsetpgrp(STDIN_FILENO, shell_pgid);
+
+	if (job_state(job) == PROC_STOPPED) {
+		if (foreground)
+			printf("\n[%d]+  Stopped                 %s\n", job->id, job->cmdline);
+		return 1;
+	}
+	// 被 Ctrl-C 中斷時換行，提示字元才不會接在 ^C 後面
+	if (foreground && WIFSIGNALED(job->status) && WTERMSIG(job->status) == SIGINT)
+		printf("\n");
+	int ret = WIFEXITED(job->status) ? 1 : -1;
+	job_remove(job);
+	return ret;
+}
+
+// wait builtin：等所有正在執行的 job，被暫停的不等
+void job_wait_all()
+{
+	struct job *job = job_list;
+	while (job) {
+		struct job *next = job->next;
+		if (job_state(job) == PROC_RUNNING)
+			job_wait(job, false);
+		job = next;
+	}
+}
+
+// 讓被暫停的 job 繼續執行 (fg / bg)
+void job_continue(struct job *job)
+{
+	for (int i = 0; i < job->nprocs; ++i)
+		if (job->states[i] == PROC_STOPPED)
+			job->states[i] = PROC_RUNNING;
+	kill(-job->pgid, SIGCONT);
+}
+
+/**
+ * @brief 回收已經結束的背景行程
+ * signalfd 沒有東西代表從上次到現在沒有子進程改變狀態，不用呼叫 waitpid
+ */
+void job_reap()
+{
+	struct signalfd_siginfo info;
+	bool changed = false;
+	while (read(sigchld_fd, &info, sizeof(info)) == sizeof(info))
+		changed = true;
+	if (!changed)
+		return;
+
+	int status;
+	pid_t pid;
+	while ((pid = waitpid(-1, &status, WNOHANG | WUNTRACED | WCONTINUED)) > 0)
+		job_update(pid, status);
+}
+
+// 在提示字元前報告已經結束的背景 job，並把它們移除
+void job_notify()
+{
+	struct job *job = job_list;
+	while (job) {
+		struct job *next = job->next;
+		if (job_state(job) == PROC_DONE) {
+			printf("[%d]%c  Done                    %s\n", job->id, next ? '-' : '+', job->cmdline);
+			job_remove(job);
+		}
+		job = next;
+	}
+}
+
+// jobs builtin：列出所有 job，已經結束的印完就移除
+void job_print()
+{
+	static const char *state_str[] = { "Running", "Stopped", "Done" };
+	struct job *job = job_list;
+	while (job) {
+		struct job *next = job->next;
+		enum proc_state state = job_state(job);
+		printf("[%d]%c  %-24s%s\n", job->id, next ? '-' : '+', state_str[state], job->cmdline);
+		if (state == PROC_DONE)
+			job_remove(job);
+		job = next;
+	}
+}
@@ -0,0 +1,202 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <spawn.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "../include/parallel.h"
+#include "../include/pathcache.h"
+#include "../include/jobs.h"
+
+// 把 s 中所有的 "{}" 換成 arg
+static char *subst(const char *s, const char *arg)
+{
+	size_t n = 0, alen = strlen(arg);
+	for (const char *p = s; (p = strstr(p, "{}")); p += 2)
+		++n;
+
+	char *out = malloc(strlen(s) + n * alen + 1), *o = out;
+	for (const char *p; (p = strstr(s, "{}")); s = p + 2) {
+		memcpy(o, s, p - s);
+		o += p - s;
+		memcpy(o, arg, alen);
+		o += alen;
+	}
+	strcpy(o, s);
+	return out;
+}
+
+/**
+ * @brief 以 arg 代入指令樣板並啟動一個 job
+ * 樣板中沒有 "{}" 時 arg 接在最後面 (和 GNU parallel 一樣)
+ * @param in -1 代表沿用 shell 的 stdin，否則 dup2 到子進程的 stdin
+ * @return int 成功回傳 0
+ */
+static int par_start(struct par_slot *slot, char **tmpl, const char *arg, int in, bool group)
+{
+	int n = 0;
+	bool placed = false;
+	while (tmpl[n]) {
+		if (strstr(tmpl[n], "{}"))
+			placed = true;
+		++n;
+	}
+	char **argv = malloc((n + 2) * sizeof(char *));
+	for (int i = 0; i < n; ++i)
+		argv[i] = subst(tmpl[i], arg);
+	if (!placed)
+		argv[n++] = strdup(arg);
+	argv[n] = NULL;
+
+	slot->out = -1;
+	posix_spawn_file_actions_t actions;
+	posix_spawn_file_actions_init(&actions);
+	if (in != -1)
+		posix_spawn_file_actions_adddup2(&actions, in, STDIN_FILENO);
+	if (group) {
+		slot->out = memfd_create("parallel", MFD_CLOEXEC);
+		if (slot->out == -1)
+			perror("memfd_create");
+		else {
+			posix_spawn_file_actions_adddup2(&actions, slot->out, STDOUT_FILENO);
+			posix_spawn_file_actions_adddup2(&actions, slot->out, STDERR_FILENO);
+		}
+	}
+	posix_spawnattr_t attr;
+	job_spawnattr(&attr, -1);
+
+	slot->pid = path_spawn(argv, &actions, &attr);
+
+	posix_spawnattr_destroy(&attr);
+	posix_spawn_file_actions_destroy(&actions);
+	for (int i = 0; i < n; ++i)
+		free(argv[i]);
+	free(argv);
+
+	if (slot->pid == -1) {
+		slot->pid = 0;
+		if (slot->out != -1)
+			close(slot->out);
+		return -1;
+	}
+	return 0;
+}
+
+// -g：job 結束後把它暫存的輸出一次寫到 stdout，不同 job 的輸出不會交錯
+static void par_flush(int fd)
+{
+	static char buf[PARALLEL_COPY_SIZE];
+	ssize_t len;
+	lseek(fd, 0, SEEK_SET);
+	while ((len = read(fd, buf, sizeof(buf))) > 0) {
+		for (ssize_t off = 0; off < len; ) {
+			ssize_t w = write(STDOUT_FILENO, buf + off, len - off);
+			if (w <= 0)
+				return;
+			off += w;
+		}
+	}
+}
+
+/**
+ * @brief parallel builtin 的主體
+ * 一開始啟動 max_jobs 個 job，之後每回收一個就補一個，直到輸入用完、全部結束
+ * @param tmpl 指令樣板
+ * @param inputs ::: 後面的參數；NULL 代表從 stdin 一行讀一個，此時子進程的 stdin 是 /dev/null
+ * @param max_jobs 同時執行的 job 數
+ * @param group 每個 job 的輸出 (stdout 與 stderr) 暫存起來，結束時整段輸出
+ * @return int 
+ * 全部成功回傳 1，有 job 無法執行或不是以 0 結束回傳 -1
+ */
+int parallel_run(char **tmpl, char **inputs, int max_jobs, bool group)
+{
+	FILE *in = NULL;
+	int null_fd = -1;
+	if (inputs == NULL) {
+		// 直接讀 fd 0，不經過 shell 讀指令用的 stdin 緩衝區；
+		// 複製出來的 fd 設 close-on-exec，不會漏給 job
+		int fd = fcntl(STDIN_FILENO, F_DUPFD_CLOEXEC, 0);
+		if (fd != -1 && (in = fdopen(fd, "r")) == NULL)
+			close(fd);
+		if (in == NULL || (null_fd = open("/dev/null", O_RDONLY | O_CLOEXEC)) == -1) {
+			perror("parallel");
+			if (in)
+				fclose(in);
+			return -1;
+		}
+	}
+
+	// 子進程與 par_flush 都直接寫 fd 1，先把 shell 自己還沒印出的東西送出去
+	fflush(stdout);
+
+	struct par_slot *slots = calloc(max_jobs, sizeof(struct par_slot));
+	char *line = NULL;
+	size_t cap = 0;
+	int running = 0, failed = 0;
+	bool more = true;
+
+	while (more || running > 0) {
+		while (more && running < max_jobs) {
+			const char *arg = NULL;
+			if (inputs) {
+				arg = *inputs;
+				if (arg)
+					++inputs;
+			} else {
+				ssize_t len = getline(&line, &cap, in);
+				if (len != -1) {
+					if (len > 0 && line[len - 1] == '\n')
+						line[len - 1] = '\0';
+					arg = line;
+				}
+			}
+			if (arg == NULL) {
+				more = false;
+				break;
+			}
+
+			int i = 0;
+			while (slots[i].pid != 0)
+				++i;
+			if (par_start(&slots[i], tmpl, arg, null_fd, group) == -1)
+				++failed;
+			else
+				++running;
+		}
+		if (running == 0)
+			break;
+
+		int status;
+		pid_t pid = waitpid(-1, &status, 0);
+		if (pid == -1)
+			break;
+
+		int i = 0;
+		while (i < max_jobs && slots[i].pid != pid)
+			++i;
+		if (i == max_jobs) {
+			// 背景 job 的行程，交回給 job control
+			job_update(pid, status);
+			continue;
+		}
+		if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+			++failed;
+		if (slots[i].out != -1) {
+			par_flush(slots[i].out);
+			close(slots[i].out);
+		}
+		slots[i].pid = 0;
+		--running;
+	}
+
+	free(line);
+	free(slots);
+	if (in)
+		fclose(in);
+	if (null_fd != -1)
+		close(null_fd);
+	return failed ? -1 : 1;
+}
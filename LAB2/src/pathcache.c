@@ -0,0 +1,193 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <spawn.h>
+#include "../include/pathcache.h"
+
+static struct path_entry *buckets[PATH_CACHE_BUCKETS];
+// 建立快取時的 PATH，PATH 被改掉之後整個快取都不能用
+static char *cached_path_env = NULL;
+
+/**
+ * @brief FNV-1a 字串雜湊，PATH 快取與 builtin 查表共用
+ */
+unsigned int name_hash(const char *s)
+{
+	unsigned int h = 2166136261u;
+	while (*s) {
+		h ^= (unsigned char)*s++;
+		h *= 16777619u;
+	}
+	return h;
+}
+
+void path_clear()
+{
+	for (int i = 0; i < PATH_CACHE_BUCKETS; ++i) {
+		while (buckets[i]) {
+			struct path_entry *e = buckets[i];
+			buckets[i] = e->next;
+			free(e->name);
+			free(e->path);
+			free(e);
+		}
+	}
+}
+
+// PATH 和建立快取時不同就清空，之後依新的 PATH 重新找
+static void check_path_env()
+{
+	const char *env = getenv("PATH");
+	if (env == NULL)
+		env = "";
+	if (cached_path_env && strcmp(cached_path_env, env) == 0)
+		return;
+	path_clear();
+	free(cached_path_env);
+	cached_path_env = strdup(env);
+}
+
+/**
+ * @brief 依序在 PATH 的每個目錄找可以執行的一般檔案 (和 execvp 的順序相同)
+ * @return 找到的完整路徑 (呼叫端負責 free)，找不到回傳 NULL
+ */
+static char *path_search(const char *name)
+{
+	const char *env = getenv("PATH");
+	if (env == NULL)
+		env = "/bin:/usr/bin";
+
+	size_t name_len = strlen(name);
+	while (1) {
+		const char *end = strchr(env, ':');
+		size_t dir_len = end ? (size_t)(end - env) : strlen(env);
+		// 空的目錄代表目前目錄
+		char *full = malloc(dir_len + name_len + 3);
+		if (dir_len == 0)
+			sprintf(full, "./%s", name);
+		else
+			sprintf(full, "%.*s/%s", (int)dir_len, env, name);
+
+		struct stat st;
+		if (stat(full, &st) == 0 && S_ISREG(st.st_mode) && access(full, X_OK) == 0)
+			return full;
+		free(full);
+
+		if (end == NULL)
+			return NULL;
+		env = end + 1;
+	}
+}
+
+/**
+ * @brief 取得指令的完整路徑，只有第一次 (或快取失效後) 才需要走過 PATH
+ * 
+ * @param name 指令名稱
+ * @return const char* 
+ * 名稱含有 '/' 時直接回傳名稱；找不到 (或名稱是空的) 回傳 NULL
+ */
+const char *path_lookup(const char *name)
+{
+	if (name == NULL || name[0] == '\0')
+		return NULL;
+	if (strchr(name, '/'))
+		return name;
+
+	check_path_env();
+	unsigned int b = name_hash(name) % PATH_CACHE_BUCKETS;
+	for (struct path_entry *e = buckets[b]; e; e = e->next) {
+		if (strcmp(e->name, name) == 0) {
+			e->hits++;
+			return e->path;
+		}
+	}
+
+	char *full = path_search(name);
+	if (full == NULL)
+		return NULL;
+	struct path_entry *e = malloc(sizeof(struct path_entry));
+	e->name = strdup(name);
+	e->path = full;
+	e->hits = 1;
+	e->next = buckets[b];
+	buckets[b] = e;
+	return e->path;
+}
+
+// 快取中的路徑已經不存在 (exec 回傳 ENOENT)，下次重新找
+void path_forget(const char *name)
+{
+	unsigned int b = name_hash(name) % PATH_CACHE_BUCKETS;
+	for (struct path_entry **p = &buckets[b]; *p; p = &(*p)->next) {
+		if (strcmp((*p)->name, name) == 0) {
+			struct path_entry *e = *p;
+			*p = e->next;
+			free(e->name);
+			free(e->path);
+			free(e);
+			return;
+		}
+	}
+}
+
+void path_print()
+{
+	int empty = 1;
+	for (int i = 0; i < PATH_CACHE_BUCKETS; ++i) {
+		for (struct path_entry *e = buckets[i]; e; e = e->next) {
+			if (empty)
+				printf("hits\tcommand\n");
+			empty = 0;
+			printf("%4d\t%s\n", e->hits, e->path);
+		}
+	}
+	if (empty)
+		printf("hash: hash table empty\n");
+}
+
+/**
+ * @brief 用 posix_spawn 執行指令，路徑由快取查出
+ * glibc 的 posix_spawn 是用 clone(CLONE_VM | CLONE_VFORK) 做的，
+ * 不會複製 shell 的 page table，啟動成本不會隨著 shell 變大而增加；
+ * exec 失敗也會直接回報給父進程，所以快取的檔案被移走時 (ENOENT) 可以在這裡重新找一次
+ * @param args 指令與參數
+ * @param actions 子進程 exec 前要做的重定向
+ * @param attr 子進程的屬性，可以是 NULL
+ * @return pid_t 
+ * 子進程的 pid，無法執行回傳 -1
+ */
+pid_t path_spawn(char **args, const posix_spawn_file_actions_t *actions,
+		const posix_spawnattr_t *attr)
+{
+	if (args[0] == NULL) {
+		fprintf(stderr, "empty command\n");
+		return -1;
+	}
+
+	const char *path = path_lookup(args[0]);
+	pid_t pid = -1;
+	int err = ENOENT;
+
+	if (path != NULL)
+		err = posix_spawn(&pid, path, actions, attr, args, environ);
+	if (err == ENOENT && path != NULL && strchr(args[0], '/') == NULL) {
+		path_forget(args[0]);
+		path = path_lookup(args[0]);
+		if (path != NULL)
+			err = posix_spawn(&pid, path, actions, attr, args, environ);
+	}
+
+	if (path == NULL) {
+		fprintf(stderr, "%s: command not found\n", args[0]);
+		return -1;
+	}
+	if (err != 0) {
+		fprintf(stderr, "%s: %s\n", args[0], strerror(err));
+		return -1;
+	}
+	return pid;
+}
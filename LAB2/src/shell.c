@@ -1,3 +1,4 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
@@ -6,8 +7,12 @@
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <fcntl.h>
+#include <spawn.h>
 #include "../include/command.h"
 #include "../include/builtin.h"
+#include "../include/pathcache.h"
+#include "../include/shell.h"
+#include "../include/jobs.h"
 
 // ======================= requirement 2.3 =======================
 /**
@@ -52,12 +57,67 @@ void redirection(struct cmd_node *p){
 // ===============================================================
 
 // ======================= requirement 2.2 =======================
+/**
+ * @brief 
+ * Launch one external command without waiting for it
+ * 不用 fork() 複製整個 shell，而是把重定向寫成 posix_spawn 的 file actions：
+ * p->in / p->out 是 pipe 的兩端 (或 0 / 1)，in_file / out_file 由父進程先開好，
+ * 子進程在 exec 前 dup2 到 stdin / stdout。
+ * 父進程開的 fd 都有 O_CLOEXEC，子進程只會留下 dup2 過去的那兩個
+ * @param p cmd_node structure
+ * @param pgid 要加入的 process group，0 代表開新的 group (pipeline 的第一個命令)
+ * @return pid_t 
+ * Return the child's pid, or -1 if it could not be started
+ */
+pid_t launch_proc(struct cmd_node *p, pid_t pgid)
+{
+    int in = p->in, out = p->out;
+    int in_file = -1, out_file = -1;
+
+    if (p->in_file) {
+        in_file = open(p->in_file, O_RDONLY | O_CLOEXEC);
+        if (in_file == -1) {
+            perror("open in_file failed");
+            return -1;
+        }
+        in = in_file;
+    }
+    if (p->out_file) {
+        out_file = open(p->out_file, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (out_file == -1) {
+            perror("open out_file failed");
+            if (in_file != -1)
+                close(in_file);
+            return -1;
+        }
+        out = out_file;
+    }
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    if (in != STDIN_FILENO)
+        posix_spawn_file_actions_adddup2(&actions, in, STDIN_FILENO);
+    if (out != STDOUT_FILENO)
+        posix_spawn_file_actions_adddup2(&actions, out, STDOUT_FILENO);
+
+    posix_spawnattr_t attr;
+    job_spawnattr(&attr, pgid);
+
+    pid_t pid = path_spawn(p->args, &actions, &attr);
+
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&actions);
+    if (in_file != -1)
+        close(in_file);
+    if (out_file != -1)
+        close(out_file);
+    return pid;
+}
+
 /**
  * @brief 
  * Execute external command
- * The external command is mainly divided into the following two steps:
- * 1. Call "fork()" to create child process
- * 2. Call "execvp()" to execute the corresponding executable file
+ * 由 launch_proc() 啟動子進程，當成一個 job 在前景等它結束 (或被 Ctrl-Z 暫停)
  * @param p cmd_node structure
  * @return int 
  * Return execution status
@@ -65,38 +125,55 @@ void redirection(struct cmd_node *p){
 
 int spawn_proc(struct cmd_node *p)
 {
+    p->in = STDIN_FILENO;
+    p->out = STDOUT_FILENO;
+    pid_t pid = launch_proc(p, 0);
+    if (pid == -1)
+        return -1;
+
+    struct job *job = job_new(p);
+    job_add_proc(job, pid);
+
+    // 正常結束回傳 1 (回傳 0 會跟 exit 的 status 相同)
+    return job_wait(job, true);
+}
+
+/**
+ * @brief 
+ * Run a builtin followed by & as a background job
+ * builtin 沒辦法 exec，只能 fork 整個 shell，在子進程裡做重定向再執行；
+ * 子進程自成一個 process group，跟外部指令一樣登記成背景 job。
+ * 它對 shell 狀態的修改 (cd、exit ...) 只留在子進程裡，和 bash 的 subshell 相同
+ * @param cmd Command structure
+ * @param builtin searchBuiltInCommand() 找到的 builtin 編號
+ * @return int 
+ * Return 1, or -1 if the child could not be created
+ */
+int fork_builtin(struct cmd *cmd, int builtin)
+{
+    struct cmd_node *p = cmd->head;
+    // 子進程和 shell 共用 stdout 的緩衝區，fork 前先送出去才不會印兩次
+    fflush(stdout);
     pid_t pid = fork();
-    
-    // 檢查 fork 是否成功 
-    if (pid < 0) { 
+    if (pid == -1) {
         perror("fork failed");
         return -1;
     }
-    
-    // pid==0 代表是子進程
-    else if (pid == 0) { 
-    
-        // 在子進程中執行外部指令
-        if (execvp(p->args[0], p->args) == -1) {
-            perror("execvp failed");
-            exit(EXIT_FAILURE); // 如果 execvp 失敗，退出子進程
-        }
+    if (pid == 0) {
+        setpgid(0, 0);
+        jobs_subshell();
+        redirection(p);
+        int status = execBuiltInCommand(builtin, p);
+        fflush(stdout);
+        _exit(status == -1 ? 1 : 0);
     }
-    
-    // pid>0 代表是父進程 
-    else { 
-        // 等待子進程完成的 singal 
-        int status;
-        waitpid(pid, &status, 0);
-
-        // WEXITSTATUS(status) 會返回子進程的返回值，正常結束的話是 0 
-        //return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
 
-        // 但是回傳0會跟exit的status相同，所以要改成回傳1 
-        return WIFEXITED(status) ? 1 : -1;
-    }
-    
-  	return 1;
+    // 父子都設一次 pgid，不管誰先執行，之後送給整個 group 的 signal 都不會漏掉
+    setpgid(pid, pid);
+    struct job *job = job_new(p);
+    job_add_proc(job, pid);
+    printf("[%d] %d\n", job->id, job->pgid);
+    return 1;
 }
 
 // ===============================================================
@@ -106,7 +183,9 @@ int spawn_proc(struct cmd_node *p)
 /**
  * @brief 
  * Use "pipe()" to create a communication bridge between processes
- * Call "spawn_proc()" in order according to the number of cmd_node
+ * Call "launch_proc()" in order according to the number of cmd_node
+ * 整個 pipeline 是一個 job，放在同一個 process group；
+ * 以 & 結尾時不等它，交給 job_reap() 在之後回收
  * @param cmd Command structure  
  * @return int
  * Return execution status 
@@ -114,98 +193,80 @@ int spawn_proc(struct cmd_node *p)
 int fork_cmd_node(struct cmd *cmd) 
 {
     int pipefd[2];   // 用來儲存 pipe 的文件描述符
-    int in_fd = 0;   // 用來追蹤標準輸入的文件描述符，初始化為 0 (標準輸入)
+    int in_fd = STDIN_FILENO;   // 上一個管道的讀取端，第一個命令讀標準輸入
     struct cmd_node *current = cmd->head;
-    pid_t pid;
+    struct job *job = job_new(cmd->head);
 
     while (current != NULL) 
     {
-        // 建立管道
+        current->in = in_fd;
+        current->out = STDOUT_FILENO;
+
+        // 只有在有下一個命令時才建立管道 (每一組指令間的 pipe是獨立的)
+        // O_CLOEXEC：子進程只留下 dup2 到 stdin / stdout 的那一端
         if (current->next != NULL) 
         {  
-            // 只有在有下一個命令時才建立管道 (每一組指令間的 pipe是獨立的) 
-            if (pipe(pipefd) == -1) 
+            if (pipe2(pipefd, O_CLOEXEC) == -1) 
             {
                 perror("pipe failed");
-                return -1;
+                break;
             }
+            current->out = pipefd[1];
         }
 
-        // 創建子進程
-        pid = fork();
-        if (pid == -1) 
-        {
-            perror("fork failed");
-            return -1;
-        } 
-        else if (pid == 0) 
-        {
-            // 子進程
-
-            // 如果是第一個命令，檢查是否需要輸入重定向
-            if (in_fd == 0) 
-            {
-                redirection(current); // 執行輸入重定向（如果有指定的 < 文件）
-            }
-
-            // 重定向標準輸入
-            if (in_fd != 0) 
-            {  
-                // 如果不是第一個命令，in_fd 應該是上一個管道的輸出端(讀取端) 
-                dup2(in_fd, STDIN_FILENO);
-                close(in_fd);
-            }
-
-            // 重定向標準輸出
-            if (current->next != NULL) 
-            {  // 如果有下一個命令，重定向到 pipefd[1](當前管道的輸入端) 
-                dup2(pipefd[1], STDOUT_FILENO);
-                close(pipefd[0]);
-                close(pipefd[1]);
-            }
-            else 
-            {
-                // 如果是最後一個命令，執行重導向
-                redirection(current);
-            }
+        // 啟動失敗 (例如找不到指令) 時其他命令照常執行，和一般 shell 一樣
+        pid_t pid = launch_proc(current, job->pgid);
+        if (pid != -1)
+            job_add_proc(job, pid);
 
-            // 執行命令
-            if (execvp(current->args[0], current->args) == -1) 
-            {
-                perror("execvp failed");
-                exit(EXIT_FAILURE);
-            }
-        } 
-        else 
+        // 關閉不需要的文件描述符
+        if (in_fd != STDIN_FILENO) close(in_fd);   // 關閉先前的讀端
+        if (current->next != NULL)
         {
-            // 父進程
-            // 關閉不需要的文件描述符
-            if (in_fd != 0) close(in_fd);  // 關閉先前的讀端
-            close(pipefd[1]);              // 關閉當前的寫入端，保留讀取端給下一個命令使用
-            in_fd = pipefd[0];             // 更新 in_fd 為當前的讀取端 
-
-            // 不等待子進程馬上完成，因為有多個子進程
+            close(pipefd[1]);       // 關閉當前的寫入端，保留讀取端給下一個命令使用
+            in_fd = pipefd[0];      // 更新 in_fd 為當前的讀取端 
         }
 
         // 移動到下一個命令
         current = current->next;
     }
+    if (in_fd != STDIN_FILENO) close(in_fd);
 
-    // 等待所有子進程完成
-    while (wait(NULL) > 0);
+    if (job->nprocs == 0)
+    {
+        job_remove(job);
+        return -1;
+    }
+    if (cmd->background)
+    {
+        printf("[%d] %d\n", job->id, job->pgid);
+        return 1;
+    }
 
-    return 1;
+    // 等待所有子進程完成
+    return job_wait(job, true);
 }
 // ===============================================================
 
 
 void shell()
 {
+	// 每一行的字串、token 與 cmd_node 都放在這裡，執行完一次釋放
+	struct arena line_arena = { 0 };
+	jobs_init();
+
 	while (1) {
+		arena_reset(&line_arena);
+		// 回收背景 job，報告已經結束的
+		job_reap();
+		job_notify();
 		printf(">>> $ ");
-		char *buffer = read_line();
-		if (buffer == NULL)
+		char *buffer = read_line(&line_arena);
+		if (buffer == NULL) {
+			if (feof(stdin))
+				break;
 			continue;
+		}
 
 		/////////////////// ADD THIS LINE ///////////////
 		// 直接在讀取輸入後檢查是否為 "exit"
@@ -214,7 +275,9 @@ void shell()
         //     break;  // 結束 shell
         // }
 
-		struct cmd *cmd = split_line(buffer);
+		struct cmd *cmd = split_line(&line_arena, buffer);
+		if (cmd == NULL)
+			continue;
 		
 		int status = -1;
 		// only a single command
@@ -223,7 +286,10 @@ void shell()
 		if(temp->next == NULL){
 			status = searchBuiltInCommand(temp);
             
-			if (status != -1){
+			// 以 & 結尾的 builtin 跟 bash 一樣在子進程裡執行
+			if (status != -1 && cmd->background)
+				status = fork_builtin(cmd, status);
+			else if (status != -1){
 				int in = dup(STDIN_FILENO), out = dup(STDOUT_FILENO);
 				if( in == -1 || out == -1)
 					perror("dup");
@@ -242,16 +308,11 @@ void shell()
 			}
 			else{
 				//external command
-                // modify here
-                int in = dup(STDIN_FILENO), out = dup(STDOUT_FILENO);
-                if( in == -1 || out == -1)
-                    perror("dup");
-                redirection(temp);
-				status = spawn_proc(cmd->head);
-                if (temp->in_file)  dup2(in, 0);
-                if (temp->out_file){
-                    dup2(out, 1);
-			    }
+				// 重定向由 launch_proc() 交給子進程做，shell 自己的 stdin / stdout 不用動
+				if (cmd->background)
+					status = fork_cmd_node(cmd);
+				else
+					status = spawn_proc(cmd->head);
 			}
 		}
 		// There are multiple commands ( | )
@@ -259,18 +320,8 @@ void shell()
 
 			status = fork_cmd_node(cmd);
 		}
-		// free space
-		while (cmd->head) {
-			
-			struct cmd_node *temp = cmd->head;
-      		cmd->head = cmd->head->next;
-			free(temp->args);
-   	    	free(temp);
-   		}
-		free(cmd);
-		free(buffer);
-		
 		if (status == 0)  
 			break;
 	}
+	arena_free(&line_arena);
 }